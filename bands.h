@@ -0,0 +1,252 @@
+//
+//  bands.h
+//
+//  A second solver, which fills a whole row of holes (a band) at a
+//  time instead of one hole at a time.  Band i covers cell rows 2i to
+//  2i+2, and shares row 2i with band i-1.  The solver counts solutions
+//  by dynamic programming over the bands: a state after band i is the
+//  last cell row filled together with the symbols used so far in each
+//  column, which is all that the bands below depend on, and the number
+//  of ways to complete a state is worked out once and remembered.  The
+//  count is made depth first, so that it can stop as soon as it reaches
+//  a limit; two solutions are enough to show a puzzle is not unique.
+//
+//  The bands for the first row are enumerated from the hole tables;
+//  the bands for a later row are enumerated once for each cell row they
+//  can hang from, using the side pair indexes.
+//
+//  BandSolver::search has the same contract as Solver::search, so the
+//  two can be checked and timed against each other.
+//
+
+#ifndef bands_h
+#define bands_h
+
+#include <unordered_map>
+#include <vector>
+#include "hashing.h"
+#include "solver.h"
+
+template <int N>
+struct BandSolver {
+    static const int DIM = (N-1)/2;
+    using Row = std::array<int, N>;
+    using Columns = std::array<unsigned, N>;   // bit v for symbol v
+
+    struct Band {
+        std::array<const Hole*, DIM> holes;
+        Row bottom;         // the band's last cell row
+        Columns cols;       // symbols in each column, except the top row
+                            // when that is shared with the band above
+    };
+    using Key = RowKey<N>;  // the last cell row filled, and the symbols
+                            // used so far in each column
+    struct Node;
+    struct Path {       // one way to complete a state
+        const Band* band;       // the next band
+        const Node* next;       // the state below it, null after the last
+        int rep;                // which of next's paths follows
+    };
+    struct Node {
+        unsigned long long count;   // ways to complete the state, up to limit
+        Path paths[2];              // up to two of them
+        int size;
+    };
+
+    const HoleCatalog& holes;
+    Givens<N> clues;
+    long int count;                 // number of holes inspected
+    unsigned long long limit;       // counts stop here
+    std::unordered_map<Row, std::vector<Band>, ArrayHash> bands[DIM];
+    std::unordered_map<Key, Node, ArrayHash> memo[DIM];  // states above band i
+    std::vector<Band> firsts;       // first bands of the paths found
+
+    explicit BandSolver(const HoleCatalog& holes) : holes(holes) {}
+    SwissSquares<N> search(Givens<N>& hints);
+    unsigned long long solutions(const Givens<N>& hints,
+                                 unsigned long long limit = ~0ull);
+private:
+    const std::vector<Band>& bandsBelow(int i, const Row& top);
+    template <typename Visit>
+    bool enumerate(int i, const Row* top, int j, Band& band,
+                   std::array<unsigned, 3>& rows, Visit& visit);
+    const Node& complete(int i, const Key& state);
+    bool extend(int i, const Key& state, const Band& band, Node& node);
+    SwissSquare<N> solution(const Node& root, int rep);
+};
+
+template <int N>
+template <typename Visit>
+bool BandSolver<N>::enumerate(int i, const Row* top, int j, Band& band,
+                              std::array<unsigned, 3>& rows, Visit& visit) {
+    // Extend band, whose holes 0 to j-1 are chosen, in every way that
+    // keeps its cell rows free of repeats, and pass each finished band
+    // to visit.  rows holds the symbols used so far in each of them; a
+    // top row that is given is already known to be free of repeats.
+    // Returns false if visit stopped the enumeration.
+    if (j == DIM)
+        return visit(band);
+    const HoleList& list = holes[clues[i][j]];
+    HoleRange range;
+    int left = j > 0 ? band.holes[j-1]->right() : 0;
+    if (top) {
+        int t = sideValue((*top)[2*j], (*top)[2*j+1], (*top)[2*j+2]);
+        range = j > 0 ? list.sides(TOP, t, LEFT, left) : list.tops(t);
+    }
+    else
+        range = j > 0 ? list.lefts(left) : list.all();
+    for (auto h : range) {
+        const Hole& hole = list.pool[h];
+        count += 1;
+        // the left column is shared with hole j-1
+        unsigned add[3] {};
+        bool clash = false;
+        for (int r = top ? 1 : 0; r < 3; ++r) {
+            add[r] = hole.row(r);
+            if (j > 0)
+                add[r] &= ~(1u << hole.cell(r, 0));
+            clash |= (rows[r] & add[r]) != 0;
+        }
+        if (clash) continue;
+        band.holes[j] = &hole;
+        for (int r = 0; r < 3; ++r)
+            rows[r] |= add[r];
+        for (int c = j > 0 ? 1 : 0; c < 3; ++c) {
+            unsigned bits = 0;
+            for (int r = top ? 1 : 0; r < 3; ++r)
+                if (hole.cell(r, c))
+                    bits |= 1u << hole.cell(r, c);
+            band.cols[2*j+c] = bits;
+            band.bottom[2*j+c] = hole.cell(2, c);
+        }
+        bool more = enumerate(i, top, j+1, band, rows, visit);
+        for (int r = 0; r < 3; ++r)
+            rows[r] &= ~add[r];
+        if (not more)
+            return false;
+    }
+    return true;
+}
+
+template <int N>
+const std::vector<typename BandSolver<N>::Band>&
+BandSolver<N>::bandsBelow(int i, const Row& top) {
+    // The bands for clue row i > 0 that hang from cell row top, made the
+    // first time they are asked for
+    auto found = bands[i].find(top);
+    if (found != bands[i].end())
+        return found->second;
+    auto & out = bands[i][top];
+    Band band {};
+    std::array<unsigned, 3> rows {};
+    auto keep = [&out](const Band& band) {
+        out.push_back(band);
+        return true;
+    };
+    enumerate(i, &top, 0, band, rows, keep);
+    return out;
+}
+
+template <int N>
+bool BandSolver<N>::extend(int i, const Key& state, const Band& band,
+                           Node& node) {
+    // Count the completions of state that start with band i.  Returns
+    // false once node's count has reached the limit.
+    for (int c = 0; c < N; ++c)
+        if (state.cols[c] & band.cols[c])
+            return true;
+    if (i == DIM-1) {
+        node.count += 1;
+        if (node.size < 2)
+            node.paths[node.size++] = Path {&band, nullptr, 0};
+    }
+    else {
+        Key next {band.bottom, state.cols};
+        for (int c = 0; c < N; ++c)
+            next.cols[c] |= band.cols[c];
+        const Node& below = complete(i+1, next);
+        node.count = std::min(limit, node.count + below.count);
+        for (int r = 0; r < below.size and node.size < 2; ++r)
+            node.paths[node.size++] = Path {&band, &below, r};
+    }
+    return node.count < limit;
+}
+
+template <int N>
+const typename BandSolver<N>::Node&
+BandSolver<N>::complete(int i, const Key& state) {
+    // The ways to fill bands i to DIM-1 below state.  There is only
+    // one state above the first band, so its bands are not kept; the
+    // ones that start paths are copied to firsts.
+    auto found = memo[i].find(state);
+    if (found != memo[i].end())
+        return found->second;
+    Node node {0, {}, 0};
+    if (i == 0) {
+        Band band {};
+        std::array<unsigned, 3> rows {};
+        auto visit = [this, &state, &node](const Band& band) {
+            int size = node.size;
+            bool more = extend(0, state, band, node);
+            if (node.size > size) {
+                firsts.push_back(band);
+                for (int r = size; r < node.size; ++r)
+                    node.paths[r].band = &firsts.back();
+            }
+            return more;
+        };
+        enumerate(0, nullptr, 0, band, rows, visit);
+    }
+    else
+        for (auto & band : bandsBelow(i, state.row))
+            if (not extend(i, state, band, node))
+                break;
+    return memo[i].emplace(state, node).first->second;
+}
+
+template <int N>
+unsigned long long BandSolver<N>::solutions(const Givens<N>& hints,
+                                            unsigned long long limit) {
+    // The number of solutions, or limit if there are at least that many
+    clues = hints;
+    count = 0;
+    this->limit = limit;
+    for (int i = 0; i < DIM; ++i) {
+        bands[i].clear();
+        memo[i].clear();
+    }
+    firsts.clear();
+    firsts.reserve(2);      // paths point into it
+    return complete(0, Key {}).count;
+}
+
+template <int N>
+SwissSquare<N> BandSolver<N>::solution(const Node& root, int rep) {
+    // Follow one of root's paths down through the bands
+    SwissSquare<N> answer {};
+    const Node* node = &root;
+    for (int i = 0; i < DIM; ++i) {
+        const Path& path = node->paths[rep];
+        for (int j = 0; j < DIM; ++j)
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            answer[2*i+r][2*j+c] = path.band->holes[j]->cell(r, c);
+        node = path.next;
+        rep = path.rep;
+    }
+    return answer;
+}
+
+template <int N>
+SwissSquares<N> BandSolver<N>::search(Givens<N>& hints) {
+    // Up to two solutions, as Solver::search finds, though when there
+    // are two or more they may not be the same two.
+    SwissSquares<N> answer;
+    solutions(hints, 2);
+    const Node& root = memo[0].at(Key {});
+    for (int r = 0; r < root.size; ++r)
+        answer.push_back(solution(root, r));
+    return answer;
+}
+
+#endif /* bands_h */
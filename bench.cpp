@@ -0,0 +1,330 @@
+//
+//  bench.cpp
+//
+//  A fixed benchmark for the solver and the square generators, so that
+//  runs before and after a change can be compared.
+//
+//  Usage is `bench [sizes] [--threads k]`, where sizes are any of 7 and
+//  9 (both if none are given).  With k threads each puzzle is searched
+//  by Solver::search(hints, k), the parallel search, instead of the
+//  serial one.  For each size it prints one line of JSON with
+//      threads                the threads given to each search
+//      first_solve_s, first_solve_kb
+//                             the time and memory to solve the first puzzle
+//                             of the corpus from nothing, the holes for
+//                             each of its sums being generated as needed
+//      holes, make_holes_s    the holes and the time makeHoles takes to
+//                             generate them all
+//      unique, nonunique, unsolvable
+//                             for each kind of puzzle in the corpus, the
+//                             puzzles, seconds, solves_per_s, the holes
+//                             inspected (Solver::count) and the number
+//                             whose search disagreed with its kind, or
+//                             found a unique solution other than the
+//                             one Solver found
+//      band, middle           the same three for BandSolver (bands.h)
+//                             and MiddleSolver (middle.h), for 7x7 only,
+//                             and peak_kb, the most memory in use while
+//                             they ran, the holes included
+//      latin_per_s, swiss_per_s
+//                             samples per second from LatinGenerator
+//                             and SwissGenerator, seeded
+//      peak_rss_kb            the most memory in use from making the holes
+//                             to the end of Solver's searches
+//      search                 the search counters over the corpus, when
+//                             built with -DSWISS_STATS=1 (see stats.h)
+//
+//  The corpus is a fixed list of clues.  The unique puzzles are the ones
+//  in the README and some found since; the others were sampled from
+//  seeded generators.  No 9x9 puzzle is known to be unique, and none
+//  sampled was shown unsolvable in less than 20 seconds, so for 9x9
+//  those two lists are empty.  The holes are always generated, never
+//  read from a catalog file, so that generating them is timed.  The
+//  other solvers are not timed on 9x9, where they do not finish even
+//  one puzzle in ten minutes.
+//
+//  Each memory figure is the kernel's high-water mark, reset before the
+//  measurement.  Each size is benchmarked in a child process, so its
+//  figures do not depend on the sizes benchmarked before it.
+//
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "solver.h"
+#include "bands.h"
+#include "middle.h"
+#include "randomLatin.h"
+#include "randomSwiss.h"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::vector;
+using Clock = std::chrono::steady_clock;
+
+template <int N>
+struct Corpus {
+    vector<Givens<N>> unique, nonunique, unsolvable;
+    int squares;        // samples to time from each generator
+    bool others;        // whether to time the other solvers too
+};
+
+Corpus<7> corpus7() {
+    Corpus<7> corpus;
+    corpus.unique = {
+        {{{43, 23, 21}, {30, 28, 42}, {23, 32, 40}}},
+        {{{31, 34, 29}, {33, 44, 32}, {30, 27, 42}}},
+        {{{38, 31, 21}, {35, 30, 26}, {20, 40, 41}}},
+        {{{37, 31, 26}, {24, 28, 39}, {20, 36, 39}}},
+        {{{41, 26, 23}, {30, 30, 33}, {18, 34, 39}}},
+        {{{19, 31, 40}, {31, 28, 27}, {44, 34, 22}}},
+        {{{23, 32, 41}, {32, 39, 40}, {39, 29, 20}}},
+        {{{38, 26, 21}, {19, 32, 36}, {29, 40, 39}}},
+        {{{24, 29, 33}, {25, 25, 44}, {37, 34, 35}}},
+        {{{43, 35, 23}, {36, 40, 25}, {26, 36, 38}}},
+        {{{23, 30, 47}, {30, 38, 31}, {39, 34, 27}}},
+    };
+    corpus.nonunique = {
+        {{{31, 34, 27}, {39, 35, 26}, {27, 30, 41}}},
+        {{{27, 33, 38}, {34, 36, 26}, {34, 31, 31}}},
+        {{{40, 39, 27}, {31, 31, 31}, {29, 28, 32}}},
+        {{{35, 33, 33}, {30, 30, 33}, {28, 31, 34}}},
+        {{{35, 31, 30}, {33, 24, 39}, {36, 27, 29}}},
+        {{{31, 30, 33}, {29, 32, 34}, {35, 32, 27}}},
+        {{{25, 31, 34}, {31, 36, 29}, {33, 36, 35}}},
+        {{{34, 32, 29}, {30, 32, 33}, {32, 37, 31}}},
+        {{{39, 33, 29}, {39, 29, 27}, {28, 31, 33}}},
+        {{{37, 33, 31}, {26, 30, 35}, {30, 34, 31}}},
+        {{{33, 37, 26}, {26, 38, 31}, {30, 34, 35}}},
+        {{{24, 31, 35}, {32, 34, 34}, {39, 30, 25}}},
+        {{{29, 35, 36}, {30, 31, 33}, {35, 35, 25}}},
+        {{{28, 28, 44}, {39, 33, 25}, {37, 32, 26}}},
+        {{{28, 35, 39}, {29, 27, 34}, {41, 26, 26}}},
+        {{{32, 37, 36}, {29, 23, 29}, {38, 34, 29}}},
+        {{{30, 30, 36}, {22, 41, 39}, {33, 29, 28}}},
+        {{{26, 34, 30}, {32, 39, 37}, {37, 29, 27}}},
+        {{{33, 26, 30}, {33, 33, 35}, {32, 34, 37}}},
+        {{{33, 31, 34}, {28, 25, 41}, {32, 35, 29}}},
+    };
+    corpus.unsolvable = {
+        {{{30, 36, 39}, {32, 36, 37}, {30, 29, 22}}},
+        {{{36, 36, 34}, {36, 28, 31}, {30, 31, 22}}},
+        {{{37, 34, 25}, {22, 33, 38}, {37, 34, 29}}},
+        {{{44, 35, 27}, {36, 32, 30}, {18, 25, 37}}},
+        {{{37, 36, 32}, {24, 31, 33}, {39, 36, 26}}},
+        {{{37, 37, 34}, {32, 37, 30}, {24, 32, 28}}},
+        {{{35, 33, 30}, {27, 31, 35}, {41, 28, 28}}},
+        {{{40, 32, 35}, {33, 30, 29}, {36, 34, 22}}},
+        {{{38, 30, 38}, {20, 29, 38}, {31, 35, 29}}},
+    };
+    corpus.squares = 20000;
+    corpus.others = true;
+    return corpus;
+}
+
+Corpus<9> corpus9() {
+    Corpus<9> corpus;
+    corpus.nonunique = {
+        {{{34, 50, 44, 36}, {42, 40, 39, 44}, {36, 36, 41, 50}, {39, 36, 36, 38}}},
+        {{{39, 43, 47, 37}, {36, 41, 42, 50}, {33, 40, 44, 39}, {51, 39, 30, 30}}},
+        {{{44, 44, 33, 35}, {40, 52, 42, 39}, {30, 29, 49, 55}, {44, 32, 38, 41}}},
+        {{{47, 36, 24, 36}, {45, 50, 52, 34}, {36, 30, 49, 42}, {45, 33, 43, 42}}},
+        {{{39, 39, 40, 42}, {41, 38, 32, 53}, {39, 35, 41, 36}, {52, 39, 40, 28}}},
+        {{{49, 45, 43, 37}, {39, 30, 44, 44}, {33, 27, 34, 50}, {39, 37, 35, 40}}},
+        {{{41, 31, 35, 44}, {38, 48, 33, 38}, {35, 42, 40, 43}, {45, 39, 45, 40}}},
+        {{{50, 43, 40, 39}, {48, 48, 37, 30}, {43, 42, 35, 35}, {29, 38, 43, 45}}},
+        {{{35, 40, 48, 39}, {32, 38, 45, 40}, {40, 36, 37, 41}, {46, 42, 36, 38}}},
+    };
+    corpus.squares = 10000;
+    corpus.others = false;
+    return corpus;
+}
+
+double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void resetPeak() {
+    // Start the peak memory again from what is in use now.  Linux
+    // only; elsewhere the peak is the process's own.
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+long peakKB() {
+    // The most memory in use since resetPeak, in kilobytes
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::stol(line.substr(6));
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;         // kilobytes on Linux
+}
+
+template <int N, typename Search>
+void timeKind(const char* kind, const vector<Givens<N>>& puzzles,
+              size_t solutions, Search& search,
+              vector<SwissSquare<N>>& answers) {
+    // Search every puzzle with search(clues, count), which must find the
+    // given number of solutions, counting 2 for more than one.  The
+    // solution of each unique puzzle is kept in answers by the first
+    // solver timed, and a later solver that finds another is wrong too.
+    long count = 0;
+    int wrong = 0;
+    auto start = Clock::now();
+    for (size_t p = 0; p < puzzles.size(); ++p) {
+        auto clues = puzzles[p];
+        long holes = 0;
+        auto found = search(clues, holes);
+        count += holes;
+        bool bad = found.size() != solutions;
+        if (solutions == 1 and not bad) {
+            if (answers.size() <= p)
+                answers.push_back(found[0]);
+            bad = found[0] != answers[p];
+        }
+        wrong += bad;
+    }
+    double seconds = since(start);
+    cout << "\"" << kind << "\":{\"puzzles\":" << puzzles.size()
+         << ",\"seconds\":" << seconds
+         << ",\"solves_per_s\":" << (seconds > 0 ? puzzles.size()/seconds : 0)
+         << ",\"count\":" << count << ",\"wrong\":" << wrong << "}";
+}
+
+template <int N, typename Search>
+void timeKinds(const Corpus<N>& corpus, Search search,
+               vector<SwissSquare<N>>& answers) {
+    timeKind<N>("unique", corpus.unique, 1, search, answers);
+    cout << ",";
+    timeKind<N>("nonunique", corpus.nonunique, 2, search, answers);
+    cout << ",";
+    timeKind<N>("unsolvable", corpus.unsolvable, 0, search, answers);
+}
+
+template <typename Other, int N>
+void timeOther(const char* name, const Corpus<N>& corpus,
+               const HoleCatalog& holes, vector<SwissSquare<N>>& answers) {
+    // Time another solver on the corpus, which must agree with Solver,
+    // and measure its memory on its own
+    resetPeak();
+    Other other(holes);
+    cout << ",\"" << name << "\":{";
+    timeKinds<N>(corpus, [&other](Givens<N>& clues, long& count) {
+        auto found = other.search(clues);
+        count = other.count;
+        return found;
+    }, answers);
+    cout << ",\"peak_kb\":" << peakKB() << "}";
+}
+
+template <typename Generator>
+double sampleRate(Generator& gen, int squares) {
+    auto start = Clock::now();
+    long check = 0;             // keeps the samples from being optimized away
+    for (int k = 0; k < squares; ++k)
+        check += gen.next()[0][0];
+    double seconds = since(start);
+    if (check == 0)
+        cerr << "no samples" << endl;
+    return squares/seconds;
+}
+
+template <int N>
+void bench(const Corpus<N>& corpus, int threads) {
+    resetPeak();
+    auto start = Clock::now();
+    double firstSolve;
+    long firstKB;
+    {
+        Solver<N> solver("");
+        auto clues = corpus.unique.empty() ? corpus.nonunique[0]
+                                           : corpus.unique[0];
+        solver.search(clues);
+        firstSolve = since(start);
+        firstKB = peakKB();
+    }
+    resetPeak();
+    start = Clock::now();
+    Solver<N> solver("");
+    solver.makeHoles();
+    double makeHoles = since(start);
+    long holes = 0;
+    for (int sum = 0; sum < Solver<N>::SUMS; ++sum)
+        holes += solver.holes[sum].count;
+    cout << "{\"size\":" << N << ",\"threads\":" << threads
+         << ",\"first_solve_s\":" << firstSolve
+         << ",\"first_solve_kb\":" << firstKB << ",\"holes\":" << holes
+         << ",\"make_holes_s\":" << makeHoles;
+    vector<SwissSquare<N>> answers;
+    cout << ",";
+    timeKinds<N>(corpus, [&solver, threads](Givens<N>& clues, long& count) {
+        auto found = threads > 1 ? solver.search(clues, threads)
+                                 : solver.search(clues);
+        count = solver.count;
+        return found;
+    }, answers);
+    long solverKB = peakKB();
+    if (corpus.others) {
+        timeOther<BandSolver<N>, N>("band", corpus, solver.holes, answers);
+        timeOther<MiddleSolver<N>, N>("middle", corpus, solver.holes, answers);
+    }
+    LatinGenerator<N> latin(12345);
+    SwissGenerator<N> swiss(12345);
+    cout << ",\"latin_per_s\":" << sampleRate(latin, corpus.squares)
+         << ",\"swiss_per_s\":" << sampleRate(swiss, corpus.squares)
+         << ",\"peak_rss_kb\":" << solverKB;
+    solver.state.stats.json(cout);
+    cout << "}" << endl;
+}
+
+int main(int argc, char **argv) {
+    vector<int> sizes;
+    int threads = 1;
+    try {
+        for (int k = 1; k < argc; ++k)
+            if (std::string(argv[k]) == "--threads" and k+1 < argc)
+                threads = std::stoi(argv[++k]);
+            else
+                sizes.push_back(std::stoi(argv[k]));
+    }
+    catch (std::logic_error&) {         // from stoi
+        sizes = {0};
+    }
+    if (sizes.empty())
+        sizes = {7, 9};
+    for (int size : sizes)
+        if ((size != 7 and size != 9) or threads < 1) {
+            cerr << "Usage " << argv[0] << " [7] [9] [--threads k]" << endl;
+            return 1;
+        }
+    for (int size : sizes) {
+        // Each size runs in a process of its own, so that memory one
+        // leaves with the allocator does not count against the next
+        cout.flush();
+        pid_t child = fork();
+        if (child == 0) {
+            if (size == 7)
+                bench<7>(corpus7(), threads);
+            else
+                bench<9>(corpus9(), threads);
+            std::exit(0);
+        }
+        int status;
+        if (child < 0 or waitpid(child, &status, 0) != child
+            or not WIFEXITED(status) or WEXITSTATUS(status) != 0) {
+            cerr << "The " << size << "x" << size << " benchmark failed." << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+//
+//  campaign.h
+//
+//  Splitting a long run of trials across machines, and resuming it.
+//
+//  The trials of a campaign are dealt out to a fixed number of streams:
+//  stream j runs trials j, j+streams, j+2*streams, and so on.  Each
+//  stream has its own generator, whose random numbers come from the
+//  campaign's seed jumped ahead j times (see Rng::jump), so no two
+//  streams share any.  Shard k of S runs the streams whose number is k
+//  mod S.  The squares a stream samples depend only on the seed and the
+//  stream, so a campaign tries the same puzzles however it is split
+//  into shards and threads.
+//
+//  A Checkpoint file records, for each stream of a shard, the trials
+//  done and the state of its generator after them, and a run given the
+//  same file carries on from there.  The file is rewritten whole, to a
+//  temporary file that is then renamed over it, so a run killed while
+//  writing leaves the last one intact.  Trials finished after the last
+//  checkpoint are run again on resuming; the verdict cache knows their
+//  puzzles, so nothing is searched or written twice.
+//
+
+#ifndef campaign_h
+#define campaign_h
+
+#include <chrono>
+#include <cstdio>       // for rename
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Campaign {
+    uint64_t seed {0};
+    int trials {0};             // in the whole campaign
+    int streams {64};
+    int shard {0};              // this run is shard shard of shards
+    int shards {1};
+    bool chain {false};
+
+    int trialsIn(int stream) const {
+        return trials/streams + (stream < trials % streams);
+    }
+    std::vector<int> mine() const {
+        // The streams of this shard
+        std::vector<int> answer;
+        for (int j = shard; j < streams; j += shards)
+            answer.push_back(j);
+        return answer;
+    }
+    std::string header(int n) const {
+        std::ostringstream text;
+        text << "swiss-checkpoint 1 " << n << " " << seed << " " << trials
+             << " " << streams << " " << shard << " " << shards << " "
+             << chain;
+        return text.str();
+    }
+};
+
+class Checkpoint {
+    using Clock = std::chrono::steady_clock;
+    std::string path;           // empty for none
+    std::string header;
+    std::vector<int> done;      // trials done in each stream
+    std::vector<std::string> state;  // and its generator after them
+    Clock::time_point last;     // time of the last save
+    double interval;            // seconds between saves
+public:
+    Checkpoint(const std::string& path, const Campaign& campaign, int n,
+               double interval = 10)
+        : path(path), header(campaign.header(n)), done(campaign.streams),
+          state(campaign.streams), last(Clock::now()), interval(interval) {}
+    template <typename Generator>
+    bool load();
+    template <typename Generator>
+    int resume(int stream, Generator& gen) const;
+    template <typename Generator>
+    void update(int stream, int trials, const Generator& gen);
+    bool due() const;
+    bool save();
+};
+
+template <typename Generator>
+bool Checkpoint::load() {
+    // Read the file, if there is one.  Returns false if it is for a
+    // different campaign or shard, or cannot be read, or a stream's
+    // state is not one that Generator reads back whole.
+    if (path.empty())
+        return true;
+    std::ifstream in(path);
+    if (not in)
+        return true;            // nothing to resume
+    std::string line;
+    if (not std::getline(in, line) or line != header)
+        return false;
+    Generator scratch;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        int stream, trials;
+        if (not (fields >> stream >> trials) or stream < 0
+            or stream >= int(done.size()) or trials <= 0)
+            return false;
+        done[stream] = trials;
+        std::getline(fields >> std::ws, state[stream]);
+        std::istringstream text(state[stream]);
+        if (not (text >> scratch) or not (text >> std::ws).eof())
+            return false;
+    }
+    return true;
+}
+
+template <typename Generator>
+int Checkpoint::resume(int stream, Generator& gen) const {
+    // Put gen in the state saved for stream, which load has checked,
+    // and return the trials done in it, which are 0 if none were saved
+    if (done[stream] == 0)
+        return 0;
+    std::istringstream in(state[stream]);
+    in >> gen;
+    return done[stream];
+}
+
+template <typename Generator>
+void Checkpoint::update(int stream, int trials, const Generator& gen) {
+    if (path.empty())
+        return;
+    std::ostringstream text;
+    text << gen;
+    done[stream] = trials;
+    state[stream] = text.str();
+}
+
+inline bool Checkpoint::due() const {
+    return not path.empty()
+        and Clock::now() - last >= std::chrono::duration<double>(interval);
+}
+
+inline bool Checkpoint::save() {
+    if (path.empty())
+        return true;
+    last = Clock::now();
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        out << header << '\n';
+        for (size_t j = 0; j < done.size(); ++j)
+            if (done[j] > 0)
+                out << j << ' ' << done[j] << ' ' << state[j] << '\n';
+        if (not out.flush())
+            return false;
+    }
+    return std::rename(temp.c_str(), path.c_str()) == 0;
+}
+
+#endif /* campaign_h */
@@ -0,0 +1,123 @@
+//
+//  catalog.h
+//
+//  Persistent hole catalogs.  Generating the holes is the whole of a
+//  Solver's startup cost, so the first run writes the HoleCatalog to a
+//  binary file, and later runs map that file read-only.  Processes on
+//  the same machine then share the pages, and startup is just an mmap.
+//
+//  File layout (native byte order, everything 4-byte aligned):
+//      CatalogHeader
+//      start[sums+1]                   first hole of each central sum
+//      pool[holes]                     packed Hole records
+//      index[4*holes]                  side indexes
+//      offsets[4*sums*(SIDES+1)]       CSR offsets into the side indexes
+//      pairs[PAIRS*holes]              side pair indexes
+//
+//  Bump CATALOG_VERSION whenever Hole or the index layout changes.
+//
+
+#ifndef catalog_h
+#define catalog_h
+
+#include <string>
+#include <fstream>
+#include <cstring>      // for memcmp, memcpy
+#include <cstdio>       // for rename, remove
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fileheader.h"
+#include "hole.h"
+
+const unsigned CATALOG_VERSION = 6;
+
+struct CatalogHeader {
+    FileHeader file;        // whose records are the Holes
+    unsigned sums;
+    unsigned sides;
+    unsigned long long holes;
+
+    CatalogHeader() = default;
+    CatalogHeader(int n, int sums, unsigned long long holes) :
+        file("SWISSHC", CATALOG_VERSION, n, sizeof(Hole)), sums(sums),
+        sides(HoleList::SIDES), holes(holes) {}
+};
+
+inline bool saveCatalog(const HoleCatalog& catalog, int n,
+                        const std::string& path) {
+    // Write to a private temporary and rename it into place, so that
+    // concurrent workers never map a partly written file.
+    int sums = catalog.lists.size();
+    CatalogHeader header(n, sums, catalog.pool.size());
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    std::ofstream out(temp, std::ios::binary);
+    if (not out) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof header);
+    out.write(reinterpret_cast<const char*>(catalog.start.data()),
+              catalog.start.size()*sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(catalog.pool.data()),
+              catalog.pool.size()*sizeof(Hole));
+    out.write(reinterpret_cast<const char*>(catalog.index.data()),
+              catalog.index.size()*sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(catalog.offsets.data()),
+              catalog.offsets.size()*sizeof(unsigned));
+    out.write(reinterpret_cast<const char*>(catalog.pairs.data()),
+              catalog.pairs.size()*sizeof(unsigned));
+    out.close();
+    if (not out or std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+inline bool mapCatalog(HoleCatalog& catalog, int n, int sums,
+                       const std::string& path) {
+    // Returns false, leaving catalog untouched, if the file is missing
+    // or was written for a different N or catalog layout.
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 or size_t(info.st_size) < sizeof(CatalogHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = info.st_size;
+    void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    CatalogHeader header;
+    std::memcpy(&header, base, sizeof header);
+    CatalogHeader expected(n, sums, header.holes);
+    unsigned long long holes = header.holes;
+    size_t length = sizeof header + (sums+1)*sizeof(unsigned) +
+                    holes*sizeof(Hole) + 4*holes*sizeof(unsigned) +
+                    4*sums*(HoleList::SIDES+1)*sizeof(unsigned) +
+                    PAIRS*holes*sizeof(unsigned);
+    if (std::memcmp(&header, &expected, sizeof header) != 0 or size != length) {
+        munmap(base, size);
+        return false;
+    }
+    auto bytes = static_cast<const char*>(base) + sizeof header;
+    auto start = reinterpret_cast<const unsigned*>(bytes);
+    auto pool = reinterpret_cast<const Hole*>(start + sums+1);
+    auto index = reinterpret_cast<const unsigned*>(pool + holes);
+    auto offsets = index + 4*holes;
+    auto pairs = offsets + 4*sums*(HoleList::SIDES+1);
+
+    catalog.pool.clear();
+    catalog.start.clear();
+    catalog.index.clear();
+    catalog.offsets.clear();
+    catalog.pairs.clear();
+    catalog.mapping.reset(base, [size](const void* p) {
+        munmap(const_cast<void*>(p), size);
+    });
+    catalog.attach(pool, start, index, offsets, pairs, sums);
+    return true;
+}
+
+#endif /* catalog_h */
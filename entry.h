@@ -8,96 +8,126 @@
 #ifndef entry_h
 #define entry_h
 #include "hole.h"
+#include "filter.h"
 
 /*
-Entry represents a bookkeepping entry for backtrack search.
-The data members are of two kinds, "inherited" and "current."
-The inherited members are aggregated from the Entry at the
-previous level, and the current members are those determined
-at the present level.
+The search keeps one Board, which a hole is placed on when the search
+descends and removed from when it backtracks.  Entry represents a
+bookkeepping entry for one level of the backtrack search: which
+position is being filled, the candidates for it, and what placing the
+current candidate changed on the Board, so that it can be undone.
+Nothing in an Entry is heap allocated, and nothing is copied from
+level to level.
 */
 
 template <int N>
-using HoleSquare = std::array<std::array<Hole*, (N-1)/2>, (N-1)/2>;
+using HoleSquare = std::array<std::array<const Hole*, (N-1)/2>, (N-1)/2>;
 template<int N>
 using CellSquare = std::array<std::array<int, N>,N>;
 
 template<int N>
-struct Entry {
-    static const int DIM = (N-1)/2;
-    
-    // These members are copied from preceding level, then updated
-    // Note that filled will reflect the choice made at this level,
-    // cells only reflects choices at prior levels.
-    
-    //These memebrs are copied from the previous level and updated
-    
+struct Board {
     HoleSquare<N> filled {};      // holes that have been filled in
     CellSquare<N> cells {};       // cells that have been filled in
+    std::array<unsigned, N> rowUsed {};  // symbols in each row of cells,
+    std::array<unsigned, N> colUsed {};  // bit v for symbol v
+
+    unsigned place(int row, int col, const Hole* hole);
+    void remove(int row, int col, unsigned placed);
+};
+
+template<int N>
+unsigned Board<N>::place(int row, int col, const Hole* hole) {
+    // Fill in hole at (row, col).  Returns a mask of the cells that
+    // were empty before, bit 3*r+c for cell (r, c) of the hole; the
+    // others are shared with neighbours and already hold the same value.
+    int baseRow = 2*row;
+    int baseCol = 2*col;
+    unsigned placed = 0;
+    filled[row][col] = hole;
+    for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c) {
+        int value = hole->cell(r, c);
+        if (value == 0 or cells[baseRow+r][baseCol+c] != 0) continue;
+        cells[baseRow+r][baseCol+c] = value;
+        rowUsed[baseRow+r] |= 1u << value;
+        colUsed[baseCol+c] |= 1u << value;
+        placed |= 1u << (3*r+c);
+    }
+    return placed;
+}
+
+template<int N>
+void Board<N>::remove(int row, int col, unsigned placed) {
+    // Undo place(row, col, hole), which returned placed.  The hole's
+    // symbols were new to their rows and columns, so clearing their
+    // bits restores the masks.
+    int baseRow = 2*row;
+    int baseCol = 2*col;
+    const Hole* hole = filled[row][col];
+    for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c) {
+        if (not (placed & 1u << (3*r+c))) continue;
+        int value = hole->cell(r, c);
+        cells[baseRow+r][baseCol+c] = 0;
+        rowUsed[baseRow+r] &= ~(1u << value);
+        colUsed[baseCol+c] &= ~(1u << value);
+    }
+    filled[row][col] = nullptr;
+}
+
+template<int N>
+struct Entry {
+    static const int DIM = (N-1)/2;
     
-    // These members are initiated at every level
     int row;
     int col;
     
-    std::vector<Constraint> overlaps;
-    std::vector<Hole*>::iterator candidates;
-    std::vector<Hole*>::iterator stop;
+    Constraints overlaps;
+    const Hole* pool;             // holes with this level's central sum
+    const unsigned* candidates;   // hole numbers in pool
+    const unsigned* stop;
+    HoleFilter filter;            // what a hole here must satisfy
+    unsigned placed;              // cells filled by this level's hole
 
     Entry() = default;
-    bool suitable (Hole* hole);
-    void updateCells(const Entry& previous);
+    bool suitable (const Hole* hole);
+    void updateFilter(const Board<N>& board);
 };
 
 template<int N>
-bool Entry<N>::suitable (Hole* hole) {
+bool Entry<N>::suitable (const Hole* hole) {
     // Is hole suitable at this level?
     // Must satify all constraints and not violate "Latinity"
-    for (auto constraint : overlaps)
-        if (not constraint.match(hole))
-            return false;
-    // To test Latinity, simulate filling in the square
-    Set<N> used;
-    CellSquare<N> test(cells);
-    int rowBase = 2*row;
-    int colBase = 2*col;
-    for (int r = 0; r < 3; ++r)
-    for (int c = 0; c< 3; ++c) {
-        auto value = hole->cells[r][c];
-        test[rowBase+r][colBase+c] = value;
-    }
-    for (int r = 0; r < 3; ++r) {
-        used.reset();
-        for (int c = 0; c < N; ++c){
-            int value = test[rowBase+r][c];
-            if (value == 0) continue;
-            if (used[value]) return false;
-            used.set(value);
-        }
-    }
-    for (int c = 0; c < 3; ++c) {
-        used.reset();
-        for (int r = 0; r < N; ++r){
-            int value = test[r][colBase+c];
-            if (value == 0) continue;
-            if (used[value]) return false;
-            used.set(value);
-        }
-    }
-    return true;
+    return filter.accepts(*hole);
 }
 
 template<int N>
-void Entry<N>::updateCells(const Entry& previous) {
-    int baseRow = 2*previous.row;
-    int baseCol = 2*previous.col;
-    Hole& hole = *filled[row][col];
+void Entry<N>::updateFilter(const Board<N>& board) {
+    // Set up the filter for the hole at (row, col) from the overlaps
+    // and the symbols used so far.  Cells of the hole that are already
+    // filled are shared with a neighbour, and the constraints make the
+    // candidate agree with them, so their symbols are left out of the
+    // masks.
+    filter.clear();
+    for (auto & constraint : overlaps)
+        filter.require(constraint.side, constraint.value);
+    int rowBase = 2*row;
+    int colBase = 2*col;
+    unsigned rowMask[3], colMask[3];
+    for (int i = 0; i < 3; ++i) {
+        rowMask[i] = board.rowUsed[rowBase+i];
+        colMask[i] = board.colUsed[colBase+i];
+    }
     for (int r = 0; r < 3; ++r)
-    for (int c = 0; c < 3; ++c){
-        int value = hole.cells[r][c];
-        if (value != 0)
-            cells[baseRow+r][baseCol+c] = value;
+    for (int c = 0; c < 3; ++c) {
+        int value = board.cells[rowBase+r][colBase+c];
+        if (value == 0) continue;
+        rowMask[r] &= ~(1u << value);
+        colMask[c] &= ~(1u << value);
     }
+    for (int k = 0; k < 8; ++k)
+        filter.forbid[k] = rowMask[CELL_ROW[k]] | colMask[CELL_COL[k]];
 }
 
 #endif
-
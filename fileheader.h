@@ -0,0 +1,34 @@
+//
+//  fileheader.h
+//
+//  The header that starts each binary file: the hole catalog, the
+//  verdict cache and binary puzzle output.  It says what the file is,
+//  the version of its layout, the N it was written for, the size of its
+//  records and the byte order it was written in.  A file is only read
+//  if its header is exactly the one a reader would write.
+//
+
+#ifndef fileheader_h
+#define fileheader_h
+
+#include <cstring>      // for memcmp, memcpy
+
+struct FileHeader {
+    char magic[8];
+    unsigned version;
+    unsigned n;
+    unsigned recordSize;
+    unsigned byteOrder;         // 0x01020304 as written
+
+    FileHeader() = default;
+    FileHeader(const char (&kind)[8], unsigned version, int n,
+               unsigned recordSize) :
+        version(version), n(n), recordSize(recordSize), byteOrder(0x01020304) {
+        std::memcpy(magic, kind, sizeof magic);
+    }
+    bool operator==(const FileHeader& other) const {
+        return std::memcmp(this, &other, sizeof other) == 0;
+    }
+};
+
+#endif /* fileheader_h */
@@ -0,0 +1,149 @@
+//
+//  filter.h
+//
+//  Batch filtering of candidate holes.  The search scans runs of hole
+//  numbers from a HoleList index looking for the next hole that fits;
+//  with AVX2 a block of eight candidates is tested at once, gathering
+//  their packed codes, and the survivors come back as a bitmask.
+//  Without AVX2 the same tests are made one hole at a time.
+//
+//  Both tests work on the code without unpacking it.  The sides a
+//  hole must have fix the symbols in some of its cells, so they are
+//  one mask and the bits the code must have under it.  A symbol may
+//  not go in a cell if it is already in the cell's row or column of
+//  the board, which is bit symbol of that cell's forbid mask.
+//
+
+#ifndef filter_h
+#define filter_h
+
+#include <algorithm>    // for min
+#include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#include "hole.h"
+
+struct HoleFilter {
+    // What a hole must satisfy at one position of the board
+    static const int BLOCK = 8;
+    uint32_t sideMask;      // bits of a hole's code its sides fix
+    uint32_t sideBits;      // and what they must be
+    bool impossible;        // two sides want different corners
+    unsigned forbid[8];     // symbols each cell may not hold
+
+    void clear() {sideMask = sideBits = 0; impossible = false;}
+    void require(int side, int value);
+    bool matches(const Hole& hole) const;
+    bool accepts(const Hole& hole) const;
+#ifdef __AVX2__
+    unsigned block(const Hole* pool, const unsigned* c) const;
+#endif
+    const unsigned* first(const Hole* pool, const unsigned* c,
+                          const unsigned* stop) const;
+    int collect(const Hole* pool, const unsigned*& c, const unsigned* stop,
+                int limit, long& scanned, std::vector<unsigned>& out) const;
+};
+
+inline void HoleFilter::require(int side, int value) {
+    // A hole must have value, made by sideValue, on side
+    int symbols[3] = {value >> 8, value >> 4 & 15, value & 15};
+    for (int i = 0; i < 3; ++i) {
+        int shift = 4*SIDE_CELLS[side][i];
+        uint32_t bits = uint32_t(symbols[i]) << shift;
+        if (sideMask >> shift & 15 and (sideBits ^ bits) >> shift & 15)
+            impossible = true;
+        sideMask |= 15u << shift;
+        sideBits |= bits;
+    }
+}
+
+inline bool HoleFilter::matches(const Hole& hole) const {
+    // Does hole have the sides its filled neighbours require?
+    return (hole.code & sideMask) == sideBits and not impossible;
+}
+
+inline bool HoleFilter::accepts(const Hole& hole) const {
+    if (not matches(hole)) return false;
+    for (int k = 0; k < 8; ++k)
+        if (forbid[k] >> hole.symbol(k) & 1)
+            return false;
+    return true;
+}
+
+#ifdef __AVX2__
+
+inline unsigned HoleFilter::block(const Hole* pool, const unsigned* c) const {
+    // Bit i is set if pool[c[i]] is acceptable, for i < BLOCK
+    static_assert(sizeof(Hole) == 4, "Hole must be one packed word");
+    if (impossible)
+        return 0;
+    __m256i holes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c));
+    __m256i code = _mm256_i32gather_epi32(reinterpret_cast<const int*>(pool),
+                                          holes, 4);
+    __m256i sides = _mm256_and_si256(code, _mm256_set1_epi32(sideMask));
+    __m256i bad = _mm256_xor_si256(
+        _mm256_cmpeq_epi32(sides, _mm256_set1_epi32(sideBits)),
+        _mm256_set1_epi32(-1));
+    if (_mm256_testc_si256(bad, _mm256_set1_epi32(-1)))
+        return 0;
+    // Bit 0 of a lane of hits is set once a cell's symbol is forbidden
+    __m256i hits = _mm256_setzero_si256();
+    for (int k = 0; k < 8; ++k) {
+        if (forbid[k] == 0) continue;
+        __m256i symbol = _mm256_and_si256(
+            _mm256_srl_epi32(code, _mm_cvtsi32_si128(4*k)),
+            _mm256_set1_epi32(15));
+        hits = _mm256_or_si256(hits,
+            _mm256_srlv_epi32(_mm256_set1_epi32(forbid[k]), symbol));
+    }
+    bad = _mm256_or_si256(bad, _mm256_slli_epi32(hits, 31));
+    return ~_mm256_movemask_ps(_mm256_castsi256_ps(bad)) & 0xff;
+}
+
+#endif
+
+inline const unsigned* HoleFilter::first(const Hole* pool, const unsigned* c,
+                                         const unsigned* stop) const {
+    // The first acceptable candidate in [c, stop), or stop if none is
+#ifdef __AVX2__
+    while (stop - c >= BLOCK) {
+        unsigned survivors = block(pool, c);
+        if (survivors)
+            return c + __builtin_ctz(survivors);
+        c += BLOCK;
+    }
+#endif
+    while (c < stop and not accepts(pool[*c]))
+        c++;
+    return c;
+}
+
+inline int HoleFilter::collect(const Hole* pool, const unsigned*& c,
+                               const unsigned* stop, int limit, long& scanned,
+                               std::vector<unsigned>& out) const {
+    // The number of acceptable candidates in [c, stop), which are
+    // appended to out in order, counting no further once it reaches
+    // limit.  c is left after the last candidate looked at, whole blocks
+    // of them with AVX2, and the number looked at is added to scanned.
+    auto start = c;
+    int n = 0;
+#ifdef __AVX2__
+    while (stop - c >= BLOCK and n < limit) {
+        unsigned survivors = block(pool, c);
+        n += __builtin_popcount(survivors);
+        for (; survivors; survivors &= survivors - 1)
+            out.push_back(c[__builtin_ctz(survivors)]);
+        c += BLOCK;
+    }
+#endif
+    for (; c < stop and n < limit; ++c)
+        if (accepts(pool[*c])) {
+            out.push_back(*c);
+            n += 1;
+        }
+    scanned += c - start;
+    return std::min(n, limit);
+}
+
+#endif /* filter_h */
@@ -0,0 +1,41 @@
+//
+//  hashing.h
+//
+//  Hashing the arrays that tables are keyed on.  A RowKey is a cell row
+//  together with the symbols used in each column, which is how
+//  BandSolver remembers a state and what MiddleSolver joins the two
+//  halves of the square on.  The verdict cache keys on clue grids.
+//
+
+#ifndef hashing_h
+#define hashing_h
+
+#include <array>
+#include <cstddef>
+
+template <int N>
+struct RowKey {
+    std::array<int, N> row;
+    std::array<unsigned, N> cols;       // bit v for symbol v
+    bool operator==(const RowKey& other) const {
+        return row == other.row and cols == other.cols;
+    }
+};
+
+struct ArrayHash {
+    // Hashes std::arrays of integers, arrays of those, and RowKeys
+    size_t operator()(long long value) const {return value;}
+    template <typename T, size_t K>
+    size_t operator()(const std::array<T, K>& items) const {
+        size_t h = 0;
+        for (auto & item : items)
+            h = h*31 + (*this)(item);
+        return h;
+    }
+    template <int N>
+    size_t operator()(const RowKey<N>& key) const {
+        return (*this)(key.row)*1000003 + (*this)(key.cols);
+    }
+};
+
+#endif /* hashing_h */
@@ -11,66 +11,355 @@
 
 #include <vector>
 #include <array>
+#include <cstdint>
+#include <atomic>
+#include <memory>   // for shared_ptr, unique_ptr
+#include <mutex>
+#include <algorithm> // for equal_range
 #include "alias.h"
 
+enum Side {TOP, BOTTOM, LEFT, RIGHT};
+
+// The eight cells of a hole are numbered clockwise from its top left
+// corner; the centre is always empty.
+constexpr int CELL_ROW[8] = {0, 0, 0, 1, 2, 2, 2, 1};
+constexpr int CELL_COL[8] = {0, 1, 2, 2, 2, 1, 0, 0};
+constexpr int CELL_AT[3][3] = {{0, 1, 2}, {7, -1, 3}, {6, 5, 4}};
+// The cells along each Side, in the order of their nibbles in its value
+constexpr int SIDE_CELLS[4][3] = {{0, 1, 2}, {6, 5, 4}, {0, 7, 6}, {2, 3, 4}};
+
+// A side value holds the three symbols along the side, four bits each,
+// the first in the highest nibble
+constexpr int sideValue(int a, int b, int c) {return a << 8 | b << 4 | c;}
+
 struct Hole{
-    int top;    // 3-digit integer in base 10
-    int bottom;
-    int left;
-    int right;
-    int sum;
-    int cells[3][3];
-    Hole(int c[]) {
-        top    = 100*c[0] + 10*c[1] + c[2];
-        right  = 100*c[2] + 10*c[3] + c[4];
-        left   = 100*c[0] + 10*c[7] + c[6];
-        bottom = 100*c[6] + 10*c[5] + c[4];
-        sum = 0;
-        for ( int i = 0; i < 8; ++ i)
-            sum += c[i];
-        cells[0][0] = c[0];
-        cells[0][1] = c[1];
-        cells[0][2] = c[2];
-        cells[1][0] = c[7];
-        cells[1][1] = 0;
-        cells[1][2] = c[3];
-        cells[2][0] = c[6];
-        cells[2][1] = c[5];
-        cells[2][2] = c[4];
+    // The symbol in cell k is in bits 4k to 4k+3 of code.  Everything
+    // else is unpacked from code when it is asked for.  Side values are
+    // the symbols along the side as in SIDE_CELLS, by sideValue, so
+    // symbols go up to 15.
+    uint32_t code {};
+    Hole() = default;
+    constexpr Hole(const int c[]) {
+        for (int k = 0; k < 8; ++k)
+            code |= uint32_t(c[k]) << 4*k;
+    }
+    constexpr int symbol(int k) const {return code >> 4*k & 15;}
+    constexpr int cell(int r, int c) const {
+        return CELL_AT[r][c] < 0 ? 0 : symbol(CELL_AT[r][c]);
+    }
+    constexpr int side(int s) const {
+        return sideValue(symbol(SIDE_CELLS[s][0]), symbol(SIDE_CELLS[s][1]),
+                         symbol(SIDE_CELLS[s][2]));
     }
+    constexpr int top() const {return side(TOP);}
+    constexpr int bottom() const {return side(BOTTOM);}
+    constexpr int left() const {return side(LEFT);}
+    constexpr int right() const {return side(RIGHT);}
+    constexpr int sum() const {
+        // add the symbols in pairs to make four bytes, then the bytes
+        uint32_t pairs = (code & 0x0f0f0f0f) + (code >> 4 & 0x0f0f0f0f);
+        return pairs * 0x01010101u >> 24;
+    }
+    constexpr unsigned row(int r) const {
+        // symbols used in row r, bit v for symbol v
+        unsigned bits = 0;
+        for (int c = 0; c < 3; ++c)
+            if (cell(r, c))
+                bits |= 1u << cell(r, c);
+        return bits;
+    }
+    constexpr unsigned col(int c) const {
+        unsigned bits = 0;
+        for (int r = 0; r < 3; ++r)
+            if (cell(r, c))
+                bits |= 1u << cell(r, c);
+        return bits;
+    }
+};
+
+// Pairs of sides, each with the smaller Side first
+const int PAIRS = 6;
+constexpr Side PAIR_SIDES[PAIRS][2] = {
+    {TOP, BOTTOM}, {TOP, LEFT}, {TOP, RIGHT},
+    {BOTTOM, LEFT}, {BOTTOM, RIGHT}, {LEFT, RIGHT}
+};
+constexpr int sidePair(Side a, Side b) {    // requires a < b
+    return a*(7-a)/2 + b-a-1;
+}
+
+constexpr int sideValue(const Hole& hole, int side) {
+    return hole.side(side);
+}
+
+struct HoleRange {
+    // Contiguous run of hole numbers in a HoleList index
+    const unsigned* first;
+    const unsigned* last;
+    const unsigned* begin() const {return first;}
+    const unsigned* end() const {return last;}
+    size_t size() const {return last - first;}
 };
 
 struct HoleList {
-    std::vector<Hole*> all;
-    std::vector<Hole*> tops[1000];
-    std::vector<Hole*> bottoms[1000];
-    std::vector<Hole*> lefts[1000];
-    std::vector<Hole*> rights[1000];
+    // Read-only view of the holes with a given central sum.  The holes
+    // themselves are packed in pool; for each side, index lists hole
+    // numbers ordered by the value of that side, and offsets[side][v]
+    // is where the run with side value v starts (CSR layout).  For
+    // each pair of sides a < b, pairs[sidePair(a, b)] lists the hole
+    // numbers ordered by side a, then side b; its runs for side a are
+    // where they are in index[a], and are searched for side b.
+    static const int SIDES = 4096;  // side values are three 4-bit symbols
+    const Hole* pool;
+    const unsigned* index[4];
+    const unsigned* offsets[4];     // SIDES+1 entries each
+    const unsigned* pairs[PAIRS];
     int count;  // number of holes with given central sum
+    
+    HoleRange side(Side s, int value) const {
+        return {index[s] + offsets[s][value], index[s] + offsets[s][value+1]};
+    }
+    HoleRange sides(Side a, int va, Side b, int vb) const {
+        // holes with side a equal to va and side b equal to vb
+        if (b < a) {
+            std::swap(a, b);
+            std::swap(va, vb);
+        }
+        const unsigned* p = pairs[sidePair(a, b)];
+        auto range = std::equal_range(p + offsets[a][va], p + offsets[a][va+1],
+                                      vb, Before{pool, b});
+        return {range.first, range.second};
+    }
+    HoleRange all() const {     // holes are generated in order of their tops
+        return {index[TOP], index[TOP] + count};
+    }
+    HoleRange tops(int value) const {return side(TOP, value);}
+    HoleRange bottoms(int value) const {return side(BOTTOM, value);}
+    HoleRange lefts(int value) const {return side(LEFT, value);}
+    HoleRange rights(int value) const {return side(RIGHT, value);}
+
+    struct Before {     // compares side values of hole numbers
+        const Hole* pool;
+        Side side;
+        bool operator()(unsigned h, int v) const {return sideValue(pool[h], side) < v;}
+        bool operator()(int v, unsigned h) const {return v < sideValue(pool[h], side);}
+    };
 };
 
+constexpr void sortBySide(const Hole* first, int count, int side,
+                          const unsigned* in, unsigned* out, unsigned* off,
+                          int values = HoleList::SIDES) {
+    // Stable counting sort of the hole numbers in[0..count), or of
+    // 0..count-1 if in is null, by the value of side, which must be less
+    // than values.  off must hold values+1 zeros; on return off[v] is
+    // where the run of holes with side value v starts in out.  The loops
+    // over values stop one past the greatest present, which saves most
+    // of the work for small N, and the offsets above it are all count.
+    int top = 0;
+    for (int h = 0; h < count; ++h) {
+        int v = sideValue(first[in ? in[h] : h], side);
+        off[v+1] += 1;
+        top = v+1 > top ? v+1 : top;
+    }
+    for (int v = 0; v < top; ++v)
+        off[v+1] += off[v];
+    for (int h = 0; h < count; ++h) {
+        unsigned k = in ? in[h] : h;
+        // off[v] counts up as the run fills; put it back after
+        out[off[sideValue(first[k], side)]++] = k;
+    }
+    for (int v = top; v > 0; --v)
+        off[v] = off[v-1];
+    off[0] = 0;
+    for (int v = top+1; v <= values; ++v)
+        off[v] = count;
+}
+
+inline void sortSum(const Hole* first, int count, unsigned* index,
+                    unsigned* offsets, unsigned* pairs) {
+    // Build the side and pair indexes of the count holes from first,
+    // all with the same sum, laid out as a HoleList expects them.
+    // offsets must hold 4*(SIDES+1) zeros.
+    const int SIDES = HoleList::SIDES;
+    for (int side = 0; side < 4; ++side)
+        sortBySide(first, count, side, nullptr, index + side*count,
+                   offsets + side*(SIDES+1));
+    std::vector<unsigned> scratch(SIDES+1);
+    for (int p = 0; p < PAIRS; ++p) {
+        // sort the index for the second side by the first side
+        int a = PAIR_SIDES[p][0];
+        int b = PAIR_SIDES[p][1];
+        std::fill(scratch.begin(), scratch.end(), 0);
+        sortBySide(first, count, a, index + b*count, pairs + p*count,
+                   scratch.data());
+    }
+}
+
+inline HoleList listOf(const Hole* first, int count, const unsigned* index,
+                       const unsigned* offsets, const unsigned* pairs) {
+    // The HoleList over storage laid out by sortSum
+    HoleList list {};
+    list.count = count;
+    list.pool = first;
+    for (int side = 0; side < 4; ++side) {
+        list.index[side] = index + side*count;
+        list.offsets[side] = offsets + side*(HoleList::SIDES+1);
+    }
+    for (int p = 0; p < PAIRS; ++p)
+        list.pairs[p] = pairs + p*count;
+    return list;
+}
+
+struct HoleCatalog {
+    // Owns the storage behind the HoleLists for every central sum.
+    // All the holes live in one array ordered by sum, and all the
+    // side indexes in another, so a candidate scan walks sequential
+    // memory instead of chasing heap pointers.  The storage is either
+    // built in memory by build(), or is a mapped catalog file (see
+    // catalog.h) kept alive by mapping.
+    //
+    // After lazy(), it is instead generated one sum at a time, the
+    // first time that sum is looked up, and kept in parts[sum].  Any
+    // number of threads may look up sums at once; one generates a
+    // missing sum while the others wait for it.
+    using Generator = void (*)(int sum, std::vector<Hole>& holes);
+    std::vector<Hole> pool;
+    std::vector<unsigned> start;     // holes with sum s begin at pool[start[s]]
+    std::vector<unsigned> index;
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> pairs;
+    std::shared_ptr<const void> mapping;
+    mutable std::vector<HoleList> lists;     // filled in by lookups if lazy
+
+    HoleCatalog() = default;
+    HoleCatalog(const HoleCatalog&) = delete;
+    HoleCatalog& operator=(const HoleCatalog&) = delete;
+    void build(const std::vector<Hole>& holes, int sums);
+    void attach(const Hole* pool, const unsigned* start,
+                const unsigned* index, const unsigned* offsets,
+                const unsigned* pairs, int sums);
+    void lazy(Generator generator, int sums);
+    const HoleList& operator[](int sum) const {
+        if (generator and not ready[sum].load(std::memory_order_acquire))
+            generate(sum);
+        return lists[sum];
+    }
+private:
+    struct Part {
+        std::vector<Hole> pool;
+        std::vector<unsigned> index, offsets, pairs;
+    };
+    Generator generator {nullptr};
+    mutable std::vector<Part> parts;
+    mutable std::unique_ptr<std::atomic<bool>[]> ready;
+    mutable std::mutex lock;
+    void generate(int sum) const;
+};
+
+inline void HoleCatalog::build(const std::vector<Hole>& holes, int sums) {
+    // Counting sort by sum, then by each side and each pair of sides
+    // within a sum.  The sorts are stable, so every run keeps the
+    // generation order.
+    const int SIDES = HoleList::SIDES;
+    start.assign(sums+1, 0);
+    for (auto & hole : holes)
+        start[hole.sum()+1] += 1;
+    for (int s = 0; s < sums; ++s)
+        start[s+1] += start[s];
+    std::vector<unsigned> order(holes.size());
+    std::vector<unsigned> place(start.begin(), start.end()-1);
+    for (unsigned h = 0; h < holes.size(); ++h)
+        order[place[holes[h].sum()]++] = h;
+    pool.clear();
+    pool.reserve(holes.size());
+    for (auto h : order)
+        pool.push_back(holes[h]);
+    
+    index.assign(4*pool.size(), 0);
+    offsets.assign(4*sums*(SIDES+1), 0);
+    pairs.assign(PAIRS*pool.size(), 0);
+    for (int s = 0; s < sums; ++s)
+        sortSum(pool.data() + start[s], start[s+1] - start[s],
+                index.data() + 4*start[s], offsets.data() + 4*s*(SIDES+1),
+                pairs.data() + PAIRS*start[s]);
+    mapping.reset();
+    attach(pool.data(), start.data(), index.data(), offsets.data(),
+           pairs.data(), sums);
+}
+
+inline void HoleCatalog::attach(const Hole* pool, const unsigned* start,
+                                const unsigned* index, const unsigned* offsets,
+                                const unsigned* pairs, int sums) {
+    // Point the HoleLists at catalog storage laid out as build() does
+    const int SIDES = HoleList::SIDES;
+    generator = nullptr;
+    parts.clear();
+    lists.assign(sums, HoleList{});
+    for (int s = 0; s < sums; ++s)
+        lists[s] = listOf(pool + start[s], start[s+1] - start[s],
+                          index + 4*start[s], offsets + 4*s*(SIDES+1),
+                          pairs + PAIRS*start[s]);
+}
+
+inline void HoleCatalog::lazy(Generator generator, int sums) {
+    // Start with no holes, and generate them for each sum on demand
+    pool.clear();
+    start.clear();
+    index.clear();
+    offsets.clear();
+    pairs.clear();
+    mapping.reset();
+    lists.assign(sums, HoleList{});
+    parts.assign(sums, Part{});
+    ready.reset(new std::atomic<bool>[sums]);
+    for (int s = 0; s < sums; ++s)
+        ready[s] = false;
+    this->generator = generator;
+}
+
+inline void HoleCatalog::generate(int sum) const {
+    const int SIDES = HoleList::SIDES;
+    std::lock_guard<std::mutex> guard(lock);
+    if (ready[sum].load(std::memory_order_relaxed))
+        return;                 // another thread got there first
+    Part& part = parts[sum];
+    generator(sum, part.pool);
+    int count = part.pool.size();
+    part.index.assign(4*count, 0);
+    part.offsets.assign(4*(SIDES+1), 0);
+    part.pairs.assign(PAIRS*count, 0);
+    sortSum(part.pool.data(), count, part.index.data(), part.offsets.data(),
+            part.pairs.data());
+    lists[sum] = listOf(part.pool.data(), count, part.index.data(),
+                        part.offsets.data(), part.pairs.data());
+    ready[sum].store(true, std::memory_order_release);
+}
+
 struct Constraint {
-    char side;  // will be t, b, l, or r for top, etc.
+    Side side;  // side of the hole being constrained
     int value;  // required value for the side
     size_t count;  // how many holes match this constraint?
-    Constraint(char s, int v, size_t c) : side(s), value(v), count(c) {}
+    Constraint(Side s, int v, size_t c) : side(s), value(v), count(c) {}
     Constraint() = default;
-    inline bool match(Hole* hole) {
-        switch(side) {
-            case('t'):
-                return value == hole->top;
-            case('b'):
-                return value == hole->bottom;
-            case('l'):
-                return value == hole->left;
-            case ('r'):
-                return value == hole->right;
-            default:  // will never get here
-                return false;
-        }
+    inline bool match(const Hole* hole) const {
+        return value == sideValue(*hole, side);
     }
 };
 
+struct Constraints {
+    // The constraints on one hole, one per side at most, kept inline
+    Constraint items[4];
+    int size = 0;
+    Constraint* begin() {return items;}
+    Constraint* end() {return items + size;}
+    const Constraint* begin() const {return items;}
+    const Constraint* end() const {return items + size;}
+    Constraint& back() {return items[size-1];}
+    void push_back(const Constraint& c) {items[size++] = c;}
+    void pop_back() {size -= 1;}
+    void erase(int i) {std::copy(items+i+1, items+size--, items+i);}
+    void clear() {size = 0;}
+};
+
 #endif /* hole_h */
 
 
@@ -0,0 +1,176 @@
+//
+//  holetables.h
+//
+//  Hole tables computed by the compiler.  For small N the complete set
+//  of holes, and the side indexes over it, can be built by constexpr
+//  evaluation, so the Solver starts with no setup work and the tables
+//  sit in .rodata, shared by every process running the binary.
+//
+//  Tables are compiled for N <= SWISS_STATIC_HOLES (default 5); larger
+//  N fall back on Solver::makeHoles at runtime.  The 7x7 tables have
+//  about 600,000 holes and need the compiler's constexpr limits raised:
+//      -DSWISS_STATIC_HOLES=7 -fconstexpr-ops-limit=68719476736
+//      -fconstexpr-loop-limit=100000000       (gcc)
+//  and add about 45MB to the binary.
+//
+
+#ifndef holetables_h
+#define holetables_h
+
+#include "hole.h"
+
+#ifndef SWISS_STATIC_HOLES
+#define SWISS_STATIC_HOLES 5
+#endif
+
+template <int N, typename Visit>
+constexpr int enumerateHoles(Visit visit) {
+    // Same holes in the same order as Solver::makeHoles: the cells
+    // are numbered clockwise from the top left corner, and each one
+    // must differ from the cells already chosen in its row and column.
+    // Calls visit(c) for each hole and returns the number of holes.
+    int count = 0;
+    int c[8] {};
+    for (c[0] = 1; c[0] <= N; ++c[0])
+    for (c[1] = 1; c[1] <= N; ++c[1]) {
+        if (c[1] == c[0]) continue;
+        for (c[2] = 1; c[2] <= N; ++c[2]) {
+            if (c[2] == c[0] or c[2] == c[1]) continue;
+            for (c[3] = 1; c[3] <= N; ++c[3]) {
+                if (c[3] == c[2]) continue;
+                for (c[4] = 1; c[4] <= N; ++c[4]) {
+                    if (c[4] == c[2] or c[4] == c[3]) continue;
+                    for (c[5] = 1; c[5] <= N; ++c[5]) {
+                        if (c[5] == c[1] or c[5] == c[4]) continue;
+                        for (c[6] = 1; c[6] <= N; ++c[6]) {
+                            if (c[6] == c[0] or c[6] == c[4] or c[6] == c[5])
+                                continue;
+                            for (c[7] = 1; c[7] <= N; ++c[7]) {
+                                if (c[7] == c[0] or c[7] == c[3] or c[7] == c[6])
+                                    continue;
+                                visit(c);
+                                count += 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// The tables have the same layout as the storage of a HoleCatalog
+// after build().  They are split in three so that each one is a separate
+// constant expression and stays inside the compiler's limits.
+
+template <int N>
+struct HolePool {
+    static const int SUMS = 8*N-6;
+    static const int COUNT = enumerateHoles<N>([](const int*) {});
+    unsigned start[SUMS+1] {};
+    Hole pool[COUNT] {};
+};
+
+template <int N>
+struct HoleIndex {
+    static const int SIDES = HoleList::SIDES;
+    unsigned index[4*HolePool<N>::COUNT] {};
+    unsigned offsets[4*HolePool<N>::SUMS*(SIDES+1)] {};
+};
+
+template <int N>
+struct HolePairs {
+    unsigned pairs[PAIRS*HolePool<N>::COUNT] {};
+};
+
+template <int N>
+constexpr HolePool<N> makeHolePool() {
+    // Count the holes with each sum, then enumerate again to put each
+    // one straight into its place, keeping generation order within a sum.
+    const int SUMS = HolePool<N>::SUMS;
+    HolePool<N> p {};
+    enumerateHoles<N>([&p](const int* c) {
+        int sum = 0;
+        for (int i = 0; i < 8; ++i)
+            sum += c[i];
+        p.start[sum+1] += 1;
+    });
+    for (int s = 0; s < SUMS; ++s)
+        p.start[s+1] += p.start[s];
+    unsigned place[SUMS] {};
+    for (int s = 0; s < SUMS; ++s)
+        place[s] = p.start[s];
+    enumerateHoles<N>([&p, &place](const int* c) {
+        Hole hole(c);
+        p.pool[place[hole.sum()]++] = hole;
+    });
+    return p;
+}
+
+template <int N>
+constexpr HoleIndex<N> makeHoleIndex(const HolePool<N>& p) {
+    // Counting sort by each side within a sum, as HoleCatalog::build does
+    const int SIDES = HoleIndex<N>::SIDES;
+    HoleIndex<N> t {};
+    for (int s = 0; s < HolePool<N>::SUMS; ++s) {
+        const Hole* first = p.pool + p.start[s];
+        int count = p.start[s+1] - p.start[s];
+        for (int side = 0; side < 4; ++side) {
+            unsigned* idx = t.index + 4*p.start[s] + side*count;
+            unsigned* off = t.offsets + (4*s + side)*(SIDES+1);
+            sortBySide(first, count, side, nullptr, idx, off);
+        }
+    }
+    return t;
+}
+
+template <int N>
+constexpr HolePairs<N> makeHolePairs(const HolePool<N>& p,
+                                     const HoleIndex<N>& t) {
+    // Sort each side index by the other side of each pair, as
+    // HoleCatalog::build does.  The offsets are thrown away, so they
+    // need only go up to the greatest side value for N.
+    constexpr int VALUES = sideValue(N, N, N) + 1;
+    HolePairs<N> h {};
+    for (int s = 0; s < HolePool<N>::SUMS; ++s) {
+        const Hole* first = p.pool + p.start[s];
+        int count = p.start[s+1] - p.start[s];
+        for (int q = 0; q < PAIRS; ++q) {
+            const unsigned* in = t.index + 4*p.start[s] +
+                                 PAIR_SIDES[q][1]*count;
+            unsigned* out = h.pairs + PAIRS*p.start[s] + q*count;
+            unsigned scratch[VALUES+1] {};
+            sortBySide(first, count, PAIR_SIDES[q][0], in, out, scratch,
+                       VALUES);
+        }
+    }
+    return h;
+}
+
+template <int N, bool = (N <= SWISS_STATIC_HOLES)>
+struct StaticHoles {
+    // No compiled tables for this N
+    static bool attach(HoleCatalog&) {return false;}
+};
+
+template <int N>
+struct StaticHoles<N, true> {
+    static constexpr HolePool<N> pool = makeHolePool<N>();
+    static constexpr HoleIndex<N> index = makeHoleIndex<N>(pool);
+    static constexpr HolePairs<N> pairs = makeHolePairs<N>(pool, index);
+    static bool attach(HoleCatalog& catalog) {
+        catalog.attach(pool.pool, pool.start, index.index, index.offsets,
+                       pairs.pairs, HolePool<N>::SUMS);
+        return true;
+    }
+};
+
+template <int N>
+constexpr HolePool<N> StaticHoles<N, true>::pool;
+template <int N>
+constexpr HoleIndex<N> StaticHoles<N, true>::index;
+template <int N>
+constexpr HolePairs<N> StaticHoles<N, true>::pairs;
+
+#endif /* holetables_h */
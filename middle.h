@@ -0,0 +1,212 @@
+//
+//  middle.h
+//
+//  A meet-in-the-middle solver.  The square of holes is cut at hole row
+//  S = DIM/2, so the top half is hole rows 0 to S-1 and the bottom half
+//  hole rows S to DIM-1; the two halves share cell row 2S.  Every way to
+//  fill the top half is put in a hash table, and then every way to fill
+//  the bottom half is looked up in it.
+//
+//  An even column of the square has no hole centres, so it holds every
+//  symbol once, and a bottom half therefore fixes exactly which symbols
+//  the top half must use in each even column.  The table is keyed on
+//  the shared cell row and those even column symbols; odd columns are
+//  checked after the lookup.
+//
+//  The table is limited to a given number of bytes.  If the top halves
+//  need more, they are taken a tableful at a time and the bottom halves
+//  are enumerated again for each one, trading time for memory.
+//
+//  MiddleSolver::search has the same contract as Solver::search.
+//
+
+#ifndef middle_h
+#define middle_h
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "hashing.h"
+#include "solver.h"
+
+template <int N>
+struct MiddleSolver {
+    static const int DIM = (N-1)/2;
+    static const int S = DIM/2;             // hole rows in the top half
+    static_assert(S > 0, "the square must have at least two rows of holes");
+    static const unsigned ALL = (1u << (N+1)) - 2;  // bits for symbols 1 to N
+    using Row = std::array<int, N>;
+    using Columns = std::array<unsigned, N>;
+
+    using Key = RowKey<N>;  // cell row 2S, and the symbols of the top
+                            // half in each even column
+    struct Half {           // a filled top half
+        std::array<const Hole*, S*DIM> holes;
+        Columns cols;       // symbols in each column, rows 0 to 2S
+    };
+
+    const HoleCatalog& holes;
+    Givens<N> clues;
+    long int count;                 // number of holes inspected
+    size_t capacity;                // most top halves in the table at once
+
+    // memory is the most bytes the table of top halves may use
+    explicit MiddleSolver(const HoleCatalog& holes, size_t memory = 1ul << 30);
+    SwissSquares<N> search(Givens<N>& hints);
+    unsigned long long solutions(const Givens<N>& hints,
+                                 unsigned long long limit = ~0ull);
+private:
+    unsigned long long found;
+    unsigned long long limit;
+    SwissSquares<N> answer;
+    std::vector<Half> halves;
+    std::unordered_map<Key, std::vector<unsigned>, ArrayHash> table;
+    std::unordered_set<Row, ArrayHash> sharedRows;
+
+    template <typename Visit>
+    bool fill(Board<N>& board, int first, int p, int end, Visit& visit);
+    bool join();
+};
+
+template <int N>
+MiddleSolver<N>::MiddleSolver(const HoleCatalog& holes, size_t memory) :
+    holes(holes) {
+    // A rough allowance for the hash table and buckets as well
+    capacity = std::max<size_t>(1, memory / (sizeof(Half) + sizeof(Key) + 64));
+}
+
+template <int N>
+template <typename Visit>
+bool MiddleSolver<N>::fill(Board<N>& board, int first, int p, int end,
+                           Visit& visit) {
+    // Fill the holes from hole row first onwards in row major order,
+    // from the p-th to the one before the end-th, passing each board
+    // to visit.  The first hole row may hang from a cell row already
+    // on the board.  Returns false if visit stopped the enumeration.
+    if (p == end)
+        return visit(board);
+    Entry<N> entry;
+    entry.row = first + p/DIM;
+    entry.col = p%DIM;
+    const HoleList& list = holes[clues[entry.row][entry.col]];
+    // The hole above may be in the other half, when the shared row
+    // has been written on the board
+    auto & cells = board.cells;
+    int r = 2*entry.row, c = 2*entry.col;
+    bool above = cells[r][c+1] != 0;
+    bool left = entry.col > 0;
+    int top = sideValue(cells[r][c], cells[r][c+1], cells[r][c+2]);
+    int side = left ? board.filled[entry.row][entry.col-1]->right() : 0;
+    HoleRange range = list.all();
+    if (above and left)
+        range = list.sides(TOP, top, LEFT, side);
+    else if (above)
+        range = list.tops(top);
+    else if (left)
+        range = list.lefts(side);
+    entry.overlaps.clear();     // the range meets them already
+    entry.updateFilter(board);
+    for (auto h : range) {
+        count += 1;
+        const Hole* hole = list.pool + h;
+        if (not entry.suitable(hole)) continue;
+        unsigned placed = board.place(entry.row, entry.col, hole);
+        bool more = fill(board, first, p+1, end, visit);
+        board.remove(entry.row, entry.col, placed);
+        if (not more)
+            return false;
+    }
+    return true;
+}
+
+template <int N>
+bool MiddleSolver<N>::join() {
+    // Look up every bottom half in the table.  Returns false once
+    // limit solutions have been found.
+    auto visit = [this](Board<N>& board) {
+        Row shared = board.cells[2*S];
+        Key key {shared, {}};
+        for (int c = 0; c < N; c += 2)
+            key.cols[c] = (ALL & ~board.colUsed[c]) | 1u << shared[c];
+        auto bucket = table.find(key);
+        if (bucket == table.end())
+            return true;
+        for (auto h : bucket->second) {
+            const Half& half = halves[h];
+            bool clash = false;
+            for (int c = 1; c < N; c += 2)
+                clash |= (half.cols[c] & board.colUsed[c]) != 1u << shared[c];
+            if (clash) continue;
+            found += 1;
+            if (answer.size() < 2) {
+                HoleSquare<N> soln = board.filled;
+                for (int p = 0; p < S*DIM; ++p)
+                    soln[p/DIM][p%DIM] = half.holes[p];
+                answer.push_back(holes2Square<N>(soln));
+            }
+            if (found >= limit)
+                return false;
+        }
+        return true;
+    };
+    // Only the shared rows of top halves in the table can join, so
+    // the bottom halves are filled below each of them in turn.
+    for (auto & shared : sharedRows) {
+        Board<N> board;
+        board.cells[2*S] = shared;
+        for (int c = 0; c < N; ++c) {
+            board.rowUsed[2*S] |= 1u << shared[c];
+            board.colUsed[c] = 1u << shared[c];
+        }
+        if (not fill(board, S, 0, (DIM-S)*DIM, visit))
+            return false;
+    }
+    return true;
+}
+
+template <int N>
+unsigned long long MiddleSolver<N>::solutions(const Givens<N>& hints,
+                                              unsigned long long limit) {
+    // The number of solutions, or limit if there are at least that many
+    clues = hints;
+    count = 0;
+    found = 0;
+    this->limit = limit;
+    answer.clear();
+    halves.clear();
+    table.clear();
+    sharedRows.clear();
+    Board<N> board;
+    auto store = [this](Board<N>& board) {
+        Half half;
+        for (int p = 0; p < S*DIM; ++p)
+            half.holes[p] = board.filled[p/DIM][p%DIM];
+        half.cols = board.colUsed;
+        Key key {board.cells[2*S], {}};
+        for (int c = 0; c < N; c += 2)
+            key.cols[c] = board.colUsed[c];
+        table[key].push_back(halves.size());
+        halves.push_back(half);
+        sharedRows.insert(key.row);
+        if (halves.size() < capacity)
+            return true;
+        bool more = join();
+        halves.clear();
+        table.clear();
+        sharedRows.clear();
+        return more;
+    };
+    if (fill(board, 0, 0, S*DIM, store) and not halves.empty())
+        join();
+    return found;
+}
+
+template <int N>
+SwissSquares<N> MiddleSolver<N>::search(Givens<N>& hints) {
+    // Up to two solutions, as Solver::search finds, though when there
+    // are two or more they may not be the same two.
+    solutions(hints, 2);
+    return answer;
+}
+
+#endif /* middle_h */
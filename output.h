@@ -0,0 +1,401 @@
+//
+//  output.h
+//
+//  Writing the puzzles found, and reading them back.  A PuzzleRecord is
+//  a puzzle with its solution, whether the solution passed the audit,
+//  and what finding it took.  Records go out in one of three formats:
+//
+//      TEXT    the clues and the solution as blocks of numbers, as in
+//              the README
+//      JSONL   one line of JSON per puzzle
+//      BINARY  a FileHeader, then each record's fields one after
+//              another as they are in memory, with no padding between
+//
+//  A PuzzleWriter formats each record in the calling thread and adds it
+//  whole to a buffer, so records from many threads never interleave.
+//  A thread of its own writes the buffer out once it holds BATCH bytes,
+//  once a second, and when asked to by flush(), with one write for all
+//  of it.  PuzzleReader reads any of the formats, telling them apart by
+//  their first bytes, and stops at a record that is not an N by N
+//  puzzle.
+//
+
+#ifndef output_h
+#define output_h
+
+#include <chrono>
+#include <condition_variable>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include "fileheader.h"
+#include "square.h"
+
+enum class Format {TEXT, JSONL, BINARY};
+
+inline bool parseFormat(const std::string& name, Format& format) {
+    if (name == "text") format = Format::TEXT;
+    else if (name == "jsonl") format = Format::JSONL;
+    else if (name == "binary") format = Format::BINARY;
+    else return false;
+    return true;
+}
+
+template <int N>
+struct PuzzleRecord {
+    Givens<N> clues {};
+    SwissSquare<N> solution {};
+    int correct {1};            // the solution passed the audit
+    int stream {-1};            // where it was found, or -1 if unknown
+    int trial {-1};
+    long long count {0};        // holes the search inspected
+    double seconds {0};         // time the search took
+};
+
+template <int N, typename Record, typename Visit>
+void eachField(Record& record, Visit visit) {
+    // Pass the fields of record to visit in their binary order
+    visit(record.clues);
+    visit(record.solution);
+    visit(record.correct);
+    visit(record.stream);
+    visit(record.trial);
+    visit(record.count);
+    visit(record.seconds);
+}
+
+template <int N>
+unsigned recordBytes() {
+    // The size of a binary record.  It is less than sizeof(PuzzleRecord)
+    // when the grids and ints before count are an odd number of ints,
+    // and the compiler pads them out.
+    PuzzleRecord<N> record;
+    unsigned bytes = 0;
+    eachField<N>(record, [&bytes](auto& field) {bytes += sizeof field;});
+    return bytes;
+}
+
+const unsigned PUZZLES_VERSION = 2;
+
+
+template <int N>
+void printClues(const Givens<N>& clues, std::ostream& out) {
+    for ( auto & row: clues) {
+        for ( auto & clue :row)
+            out << clue << " ";
+        out << '\n';
+    }
+    out << '\n';
+}
+
+template <int N>
+void printSolution(const SwissSquare<N>& soln, std::ostream& out) {
+    for (auto & row:soln) {
+        for (auto col:row)
+            out << col << " ";
+        out << '\n';
+    }
+    out << "\n\n";
+}
+
+template <typename Grid>
+void printJSON(const Grid& grid, std::ostream& out) {
+    out << "[";
+    for (size_t r = 0; r < grid.size(); ++r) {
+        out << (r ? ",[" : "[");
+        for (size_t c = 0; c < grid[r].size(); ++c)
+            out << (c ? "," : "") << grid[r][c];
+        out << "]";
+    }
+    out << "]";
+}
+
+template <int N>
+std::string format(const PuzzleRecord<N>& record, Format form) {
+    std::ostringstream out;
+    switch (form) {
+        case Format::TEXT:
+            printClues<N>(record.clues, out);
+            if (not record.correct)
+                out << "INCORRECT SOLUTION FOLLOWS\n";
+            printSolution<N>(record.solution, out);
+            break;
+        case Format::JSONL:
+            out << "{\"clues\":";
+            printJSON(record.clues, out);
+            out << ",\"solution\":";
+            printJSON(record.solution, out);
+            out << ",\"correct\":" << (record.correct ? "true" : "false")
+                << ",\"stream\":" << record.stream << ",\"trial\":"
+                << record.trial << ",\"count\":" << record.count
+                << ",\"seconds\":" << record.seconds << "}\n";
+            break;
+        case Format::BINARY:
+            eachField<N>(record, [&out](auto& field) {
+                out.write(reinterpret_cast<const char*>(&field), sizeof field);
+            });
+            break;
+    }
+    return out.str();
+}
+
+template <int N>
+class PuzzleWriter {
+    static const size_t BATCH = 1 << 16;
+    Format form;
+    int fd {-1};
+    std::mutex lock;
+    std::condition_variable wake;       // for the writing thread
+    std::condition_variable written;    // for threads in flush()
+    std::string pending;                // formatted, not yet written
+    unsigned long long queued {0};      // bytes ever added to pending
+    unsigned long long done {0};        // and written out
+    bool urgent {false};                // a flush() is waiting
+    bool stopping {false};
+    bool failed {false};
+    std::thread writer;
+
+    void run();
+public:
+    PuzzleWriter(const std::string& path, Format format, bool append = true);
+    ~PuzzleWriter();
+    PuzzleWriter(const PuzzleWriter&) = delete;
+    PuzzleWriter& operator=(const PuzzleWriter&) = delete;
+    bool ok();
+    void write(const PuzzleRecord<N>& record);
+    void flush();
+};
+
+template <int N>
+PuzzleWriter<N>::PuzzleWriter(const std::string& path, Format format,
+                              bool append) : form(format) {
+    int flags = O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+    fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) {
+        failed = true;
+        return;
+    }
+    // A binary file starts with its header
+    if (form == Format::BINARY and lseek(fd, 0, SEEK_END) == 0) {
+        FileHeader header("SWISSPZ", PUZZLES_VERSION, N, recordBytes<N>());
+        pending.append(reinterpret_cast<const char*>(&header), sizeof header);
+        queued = pending.size();
+    }
+    writer = std::thread(&PuzzleWriter::run, this);
+}
+
+template <int N>
+PuzzleWriter<N>::~PuzzleWriter() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (writer.joinable())
+        writer.join();
+    if (fd >= 0)
+        close(fd);
+}
+
+template <int N>
+void PuzzleWriter<N>::run() {
+    // The writing thread: take everything pending and write it while
+    // the others go on adding to a fresh buffer
+    std::string out;
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        wake.wait_for(guard, std::chrono::seconds(1), [this] {
+            return stopping or urgent or pending.size() >= BATCH;
+        });
+        urgent = false;
+        if (pending.empty()) {
+            if (stopping) return;
+            continue;
+        }
+        out.swap(pending);
+        guard.unlock();
+        bool good = true;
+        for (size_t at = 0; at < out.size(); ) {
+            ssize_t n = ::write(fd, out.data() + at, out.size() - at);
+            if (n <= 0) {
+                good = false;
+                break;
+            }
+            at += n;
+        }
+        guard.lock();
+        done += out.size();
+        failed = failed or not good;
+        out.clear();
+        written.notify_all();
+    }
+}
+
+template <int N>
+bool PuzzleWriter<N>::ok() {
+    std::lock_guard<std::mutex> guard(lock);
+    return not failed;
+}
+
+template <int N>
+void PuzzleWriter<N>::write(const PuzzleRecord<N>& record) {
+    auto bytes = format<N>(record, form);
+    bool full;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending += bytes;
+        queued += bytes.size();
+        full = pending.size() >= BATCH;
+    }
+    if (full)
+        wake.notify_one();
+}
+
+template <int N>
+void PuzzleWriter<N>::flush() {
+    // Wait until everything written so far is in the file
+    std::unique_lock<std::mutex> guard(lock);
+    if (fd < 0)
+        return;
+    auto target = queued;
+    if (done >= target)
+        return;
+    urgent = true;
+    wake.notify_one();
+    written.wait(guard, [&] {return done >= target;});
+}
+
+template <int N>
+class PuzzleReader {
+    std::istream& in;
+    Format form;
+    bool readText(PuzzleRecord<N>& record);
+    bool readJSON(PuzzleRecord<N>& record);
+    bool readBinary(PuzzleRecord<N>& record);
+    static bool fits(const PuzzleRecord<N>& record);
+public:
+    explicit PuzzleReader(std::istream& in);
+    bool good {true};           // false if a binary header did not match,
+                                // or a record was not an N by N puzzle
+    bool next(PuzzleRecord<N>& record);
+};
+
+template <int N>
+PuzzleReader<N>::PuzzleReader(std::istream& in) : in(in) {
+    // Tell the format from the first bytes
+    form = Format::TEXT;
+    in >> std::ws;
+    if (in.peek() == '{')
+        form = Format::JSONL;
+    else if (in.peek() == 'S') {
+        FileHeader header;
+        FileHeader expected("SWISSPZ", PUZZLES_VERSION, N, recordBytes<N>());
+        in.read(reinterpret_cast<char*>(&header), sizeof header);
+        form = Format::BINARY;
+        good = in.gcount() == sizeof header
+            and header == expected;
+    }
+}
+
+template <int N>
+bool PuzzleReader<N>::next(PuzzleRecord<N>& record) {
+    // Read the next record.  Text and JSON do not say what N they were
+    // written for, so one read for the wrong N is caught by its
+    // solution not having the shape of an N by N Swiss square.
+    if (not good)
+        return false;
+    bool read = false;
+    switch (form) {
+        case Format::TEXT:
+            read = readText(record);
+            break;
+        case Format::JSONL:
+            read = readJSON(record);
+            break;
+        case Format::BINARY:
+            read = readBinary(record);
+            break;
+    }
+    if (read and not fits(record))
+        good = false;
+    return read and good;
+}
+
+template <int N>
+bool PuzzleReader<N>::fits(const PuzzleRecord<N>& record) {
+    // Does the solution have zeros at the centres of the holes, and
+    // symbols from 1 to N everywhere else?
+    for (int r = 0; r < N; ++r)
+    for (int c = 0; c < N; ++c) {
+        int value = record.solution[r][c];
+        if (r % 2 and c % 2 ? value != 0 : value < 1 or value > N)
+            return false;
+    }
+    return true;
+}
+
+template <int N>
+bool PuzzleReader<N>::readBinary(PuzzleRecord<N>& record) {
+    bool whole = true;
+    eachField<N>(record, [this, &whole](auto& field) {
+        in.read(reinterpret_cast<char*>(&field), sizeof field);
+        whole = whole and in.gcount() == sizeof field;
+    });
+    return whole;
+}
+
+template <int N>
+bool PuzzleReader<N>::readText(PuzzleRecord<N>& record) {
+    // The next puzzle's numbers, skipping any words
+    const int DIM = (N-1)/2;
+    std::string word;
+    int read = 0;
+    record = PuzzleRecord<N>();
+    while (read < DIM*DIM + N*N and in >> word) {
+        if (word == "INCORRECT")
+            record.correct = 0;
+        if (word.find_first_not_of("0123456789") != std::string::npos)
+            continue;
+        int value = std::stoi(word);
+        if (read < DIM*DIM)
+            record.clues[read/DIM][read%DIM] = value;
+        else
+            record.solution[(read-DIM*DIM)/N][(read-DIM*DIM)%N] = value;
+        read += 1;
+    }
+    return read == DIM*DIM + N*N;
+}
+
+template <int N>
+bool PuzzleReader<N>::readJSON(PuzzleRecord<N>& record) {
+    // The next line, with its members in the order format() writes them
+    std::string line;
+    if (not std::getline(in, line))
+        return false;
+    for (auto & ch : line)
+        if (ch == '[' or ch == ']' or ch == ',' or ch == '{' or ch == '}'
+            or ch == ':')
+            ch = ' ';
+    std::istringstream fields(line);
+    std::string name, correct;
+    record = PuzzleRecord<N>();
+    fields >> name;
+    for (auto & row : record.clues)
+        for (auto & clue : row)
+            fields >> clue;
+    fields >> name;
+    for (auto & row : record.solution)
+        for (auto & cell : row)
+            fields >> cell;
+    fields >> name >> correct >> name >> record.stream >> name >> record.trial
+           >> name >> record.count >> name >> record.seconds;
+    record.correct = correct == "true";
+    return bool(fields);
+}
+
+#endif /* output_h */
@@ -46,6 +46,7 @@
 #include <array>
 #include <bitset>   // for audit
 #include "alias.h"
+#include "rng.h"
 
 template <int N>
 class LatinGenerator {
@@ -53,10 +54,7 @@ class LatinGenerator {
     const int MIN_ITER = 2*(N-1)*(N-1)*(N-1);
     const int DIM = (N-1)/2;
 private:
-    std::random_device rd;
-    std::mt19937 engine;
-    std::uniform_int_distribution<int> dist;
-    std::uniform_int_distribution<int> coin;
+    Rng engine;
     Square RC;  // symbol square -- coords are (row,column)
     Square CS;  // row square    -- coords are (column,symbol)
     Square RS;  // column square -- coords are (row,symbol)
@@ -71,13 +69,21 @@ private:
     
 public:
     LatinGenerator();
+    explicit LatinGenerator(uint64_t seed);
     std::array<std::array<int, N>, N> next();
+    std::array<std::array<int, N>, N> step();
+    void advance();
+    bool proper() const {return isProper;}
+    std::array<std::array<int, N>, N> square() const;
     LatinGenerator(const LatinGenerator&) = delete;
     LatinGenerator& operator=(const LatinGenerator&) = delete;
 };
 
 template <int N>
-LatinGenerator<N>::LatinGenerator() :engine(rd()),dist(1, N),coin(0, 1){
+LatinGenerator<N>::LatinGenerator() : LatinGenerator(randomSeed()) {}
+
+template <int N>
+LatinGenerator<N>::LatinGenerator(uint64_t seed) : engine(seed) {
     // start with a cyclic latin square
     for (int row = 1; row < N+1; ++row) {
         int sym = row;
@@ -95,9 +101,9 @@ template <int N>
 void LatinGenerator<N>::perturbProper() {
     // Set r0, r1, c0, c1, s0, s1
     do {
-        r0 = dist(engine);
-        c0 = dist(engine);
-        s0 = dist(engine);
+        r0 = 1 + engine.below(N);
+        c0 = 1 + engine.below(N);
+        s0 = 1 + engine.below(N);
     } while (RC[r0][c0][0] == s0);
     s1 = RC[r0][c0][0];
     r1 = CS[c0][s0][0];
@@ -113,9 +119,10 @@ void LatinGenerator<N>::perturbProper() {
 template <int N>
 void LatinGenerator<N>::perturbImproper() {
     // r0, c0, s0 are already set
-    s1 = RC[r0][c0][coin(engine)];
-    r1 = CS[c0][s0][coin(engine)];
-    c1 = RS[r0][s0][coin(engine)];
+    unsigned coins = engine.below(8);
+    s1 = RC[r0][c0][coins & 1];
+    r1 = CS[c0][s0][coins >> 1 & 1];
+    c1 = RS[r0][s0][coins >> 2];
     
     if (s1 == RC[r0][c0][0])
         RC[r0][c0][0] = RC[r0][c0][1];
@@ -156,15 +163,37 @@ void LatinGenerator<N>::update() {
 
 template <int N>
 std::array<std::array<int, N>, N> LatinGenerator<N>::next(){
-    std::array<std::array<int, N>, N> answer;
     int iters = 0;
     while (iters < MIN_ITER or not isProper ) {
-        if (isProper)
-            perturbProper();
-        else
-            perturbImproper();
+        advance();
         iters += 1;
     }
+    return square();
+}
+
+template <int N>
+void LatinGenerator<N>::advance(){
+    // One step of the chain, which may leave the square improper
+    if (isProper)
+        perturbProper();
+    else
+        perturbImproper();
+}
+
+template <int N>
+std::array<std::array<int, N>, N> LatinGenerator<N>::step(){
+    // The next proper square along the chain, which differs from the
+    // last one in only a few cells.  Successive squares are far from
+    // independent; use next() for samples.
+    do
+        advance();
+    while (not isProper);
+    return square();
+}
+
+template <int N>
+std::array<std::array<int, N>, N> LatinGenerator<N>::square() const {
+    std::array<std::array<int, N>, N> answer;
     for (int r = 0; r < N; ++r)
     for (int c = 0; c < N; ++ c)
         answer[r][c] = RC[r+1][c+1][0];
@@ -0,0 +1,192 @@
+//
+//  randomSwiss.h
+//
+/*
+ A Markov chain on Swiss squares, in the spirit of the Jacobson-Matthews chain in
+ randomLatin.h.  A Swiss square has zeros at the centres of the holes, and no symbol
+ twice in any row or column.  Many Latin squares give the same Swiss square, since
+ only the centres tell them apart, so sampling Latin squares spends work on
+ differences the puzzles never see, and weights each Swiss square by the number of
+ ways to fill in its centres.  This chain samples the Swiss squares instead, though
+ only those it can reach (see below).
+
+ Think of the square as a colouring of the cells, where two cells in the same line
+ must have different colours.  Take a cell, with symbol a, and another symbol b.  The
+ cells with a or b that can be reached from it by steps along rows and columns, each
+ step going from an a to a b or back, form a path or a cycle, called a Kempe chain.
+ Swapping a and b in all its cells gives another Swiss square.  If b is in neither
+ line through the cell, the chain is just the cell, and the swap changes one symbol.
+
+ Each step chooses a cell and a symbol uniformly at random, and swaps the chain they
+ give; a centre, or the cell's own symbol, gives no change.  The chain from a cell of
+ the new square back to the old one is the same set of cells, so the step is as
+ likely to be undone as made, and the limiting distribution is uniform on the
+ squares the chain can reach from the cyclic square it starts at.  For N = 5 it
+ reaches all 210240 Swiss squares, and visits them evenly.  For N = 3 it reaches
+ only half of the 12, but a 3x3 square is a single hole.  For N = 7 and 9 there are
+ far too many squares to check, so whether it reaches them all is not known; it is
+ uniform on the ones it does.
+
+ The square is kept with the column of each symbol in each row, and the row of each
+ symbol in each column, as in randomLatin.h, so a chain is followed in one step per
+ cell.  The state, which is the square and the random number generator, can be
+ written and read back with << and >>.
+ */
+
+#ifndef randomSwiss_h
+#define randomSwiss_h
+
+#include <array>
+#include <istream>
+#include <ostream>
+#include "rng.h"
+#include "square.h"
+
+template <int N>
+class SwissGenerator {
+    using Index = std::array<std::array<int, N+1>, N>;
+    const int MIN_ITER = 2*(N-1)*(N-1)*(N-1);
+    Rng engine;
+    SwissSquare<N> RC;  // symbol at (row,column), zero at a centre
+    Index RS;           // column of each symbol in a row, or -1
+    Index CS;           // row of each symbol in a column, or -1
+    std::array<Coords, 2*N> chain;
+    int length;         // cells in chain
+    int a, b;           // the symbols swapped
+
+    bool follow(int row, int col, bool alongRow);
+
+public:
+    SwissGenerator() : SwissGenerator(randomSeed()) {}
+    explicit SwissGenerator(uint64_t seed) : SwissGenerator(Rng(seed)) {}
+    explicit SwissGenerator(const Rng& engine);
+    SwissSquare<N> next();
+    SwissSquare<N> step();
+    bool advance();
+    const SwissSquare<N>& square() const {return RC;}
+    SwissGenerator(const SwissGenerator&) = delete;
+    SwissGenerator& operator=(const SwissGenerator&) = delete;
+
+    template <int M>
+    friend std::ostream& operator<<(std::ostream& out, const SwissGenerator<M>& gen);
+    template <int M>
+    friend std::istream& operator>>(std::istream& in, SwissGenerator<M>& gen);
+};
+
+template <int N>
+SwissGenerator<N>::SwissGenerator(const Rng& engine) : engine(engine) {
+    // start with a cyclic latin square, its centres taken out
+    for (auto & row : RS) row.fill(-1);
+    for (auto & col : CS) col.fill(-1);
+    for (int row = 0; row < N; ++row)
+    for (int col = 0; col < N; ++col) {
+        int sym = row % 2 and col % 2 ? 0 : 1 + (row + col) % N;
+        RC[row][col] = sym;
+        if (sym == 0) continue;
+        RS[row][sym] = col;
+        CS[col][sym] = row;
+    }
+}
+
+template <int N>
+bool SwissGenerator<N>::follow(int row, int col, bool alongRow) {
+    // Add the cells of the chain from (row,col), taking the first step
+    // along its row or its column, until the chain ends.  Returns true
+    // if it comes back to (row,col) instead, in a cycle.
+    int r = row, c = col;
+    int sym = RC[row][col];
+    for (;;) {
+        sym = a + b - sym;
+        if (alongRow)
+            c = RS[r][sym];
+        else
+            r = CS[c][sym];
+        if (r < 0 or c < 0)
+            return false;
+        if (r == row and c == col)
+            return true;
+        chain[length++] = {r, c};
+        alongRow = not alongRow;
+    }
+}
+
+template <int N>
+bool SwissGenerator<N>::advance() {
+    // One step of the chain; returns false if the square is unchanged
+    int row = engine.below(N);
+    int col = engine.below(N);
+    a = RC[row][col];
+    b = 1 + engine.below(N);
+    if (a == 0 or a == b)
+        return false;
+    length = 0;
+    chain[length++] = {row, col};
+    if (not follow(row, col, true))
+        follow(row, col, false);
+    for (int k = 0; k < length; ++k) {
+        auto [r, c] = chain[k];
+        RS[r][RC[r][c]] = -1;
+        CS[c][RC[r][c]] = -1;
+    }
+    for (int k = 0; k < length; ++k) {
+        auto [r, c] = chain[k];
+        int sym = a + b - RC[r][c];
+        RC[r][c] = sym;
+        RS[r][sym] = c;
+        CS[c][sym] = r;
+    }
+    return true;
+}
+
+template <int N>
+SwissSquare<N> SwissGenerator<N>::next() {
+    for (int iters = 0; iters < MIN_ITER; ++iters)
+        advance();
+    return RC;
+}
+
+template <int N>
+SwissSquare<N> SwissGenerator<N>::step() {
+    // The next different square along the chain, which differs from the
+    // last one in the cells of one Kempe chain.  Use next() for samples.
+    while (not advance())
+        ;
+    return RC;
+}
+
+template <int N>
+std::ostream& operator<<(std::ostream& out, const SwissGenerator<N>& gen) {
+    out << gen.engine;
+    for (auto & row : gen.RC)
+        for (int sym : row)
+            out << ' ' << sym;
+    return out;
+}
+
+template <int N>
+std::istream& operator>>(std::istream& in, SwissGenerator<N>& gen) {
+    // Read a state written by <<, and rebuild the indexes from it.  A
+    // square with a centre not zero, or a symbol twice in a row or a
+    // column, sets failbit.
+    in >> gen.engine;
+    for (auto & row : gen.RS) row.fill(-1);
+    for (auto & col : gen.CS) col.fill(-1);
+    for (int row = 0; row < N; ++row)
+    for (int col = 0; col < N; ++col) {
+        int sym;
+        in >> sym;
+        bool centre = row % 2 and col % 2;
+        if (sym < 0 or sym > N or (sym == 0) != centre
+            or (sym and (gen.RS[row][sym] >= 0 or gen.CS[col][sym] >= 0))) {
+            in.setstate(std::ios::failbit);
+            return in;
+        }
+        gen.RC[row][col] = sym;
+        if (sym == 0) continue;
+        gen.RS[row][sym] = col;
+        gen.CS[col][sym] = row;
+    }
+    return in;
+}
+
+#endif /* randomSwiss_h */
@@ -0,0 +1,103 @@
+//
+//  rng.h
+//
+//  A small, fast random number generator for the Latin square chains,
+//  which draw several numbers per step and take hundreds of steps per
+//  square.  This is xoshiro256** by Blackman and Vigna, seeded through
+//  splitmix64 so that any 64-bit seed, even 0, gives a good state.
+//  below(n) is unbiased, by Lemire's multiply-and-reject method, which
+//  all but never needs a division.
+//
+//  jump() moves the state on by 2^128 numbers, so the streams got from
+//  one seed by jumping 0, 1, 2, ... times never overlap.  The state can
+//  be written and read back with << and >>, like the standard engines.
+//
+
+#ifndef rng_h
+#define rng_h
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+
+class Rng {
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {return (x << k) | (x >> (64 - k));}
+public:
+    using result_type = uint64_t;
+    static constexpr result_type min() {return 0;}
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    explicit Rng(uint64_t seed = 0) {
+        for (auto & word : s) {     // splitmix64
+            uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+    result_type operator()() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+    uint32_t below(uint32_t n) {
+        // Uniform on 0 to n-1, for n > 0
+        uint64_t m = uint64_t(uint32_t((*this)() >> 32)) * n;
+        uint32_t low = uint32_t(m);
+        if (low < n) {
+            uint32_t threshold = -n % n;
+            while (low < threshold) {
+                m = uint64_t(uint32_t((*this)() >> 32)) * n;
+                low = uint32_t(m);
+            }
+        }
+        return m >> 32;
+    }
+    void jump() {
+        static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                        0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (auto word : JUMP)
+            for (int b = 0; b < 64; ++b) {
+                if (word & uint64_t(1) << b)
+                    for (int i = 0; i < 4; ++i)
+                        t[i] ^= s[i];
+                (*this)();
+            }
+        for (int i = 0; i < 4; ++i)
+            s[i] = t[i];
+    }
+    static Rng stream(uint64_t seed, int k) {
+        // The k-th of the non-overlapping streams from seed
+        Rng rng(seed);
+        for (; k > 0; --k)
+            rng.jump();
+        return rng;
+    }
+    friend std::ostream& operator<<(std::ostream& out, const Rng& rng) {
+        return out << rng.s[0] << ' ' << rng.s[1] << ' '
+                   << rng.s[2] << ' ' << rng.s[3];
+    }
+    friend std::istream& operator>>(std::istream& in, Rng& rng) {
+        return in >> rng.s[0] >> rng.s[1] >> rng.s[2] >> rng.s[3];
+    }
+};
+
+inline uint64_t randomSeed() {
+    std::random_device rd;
+    return uint64_t(rd()) << 32 | rd();
+}
+
+#endif /* rng_h */
@@ -10,59 +10,185 @@
 
 #include <iostream>
 #include <algorithm> // for sort, reverse
+#include <atomic>
+#include <memory>    // for unique_ptr
+#include <mutex>
 #include "entry.h"
+#include "square.h"
+#include "stats.h"
+#include "swaps.h"
+#include "catalog.h"
+#include "holetables.h"
+#include "workpool.h"
 
 template <int N>
-using SwissSquare = std::array<std::array<int, N>, N>;
+struct FirstTwo {
+    // Collects the solutions a search finds, stopping it at two
+    SwissSquares<N> answer;
+    bool found(const HoleSquare<N>& soln) {
+        answer.push_back(holes2Square<N>(soln));
+        return answer.size() == 2;
+    }
+    bool stopped() const {return false;}
+};
+
 template <int N>
-using SwissSquares = std::vector<SwissSquare<N>>;
+struct OtherThan {
+    // Collects the first solution a search finds other than known,
+    // which has its centres zero
+    SwissSquare<N> known;
+    SwissSquares<N> answer;
+    bool found(const HoleSquare<N>& soln) {
+        auto square = holes2Square<N>(soln);
+        if (square == known)
+            return false;
+        answer.push_back(square);
+        return true;
+    }
+    bool stopped() const {return false;}
+};
 
 template <int N>
-SwissSquare<N> holes2Square(const HoleSquare<N>& holes){
-    SwissSquare<N> answer;
-    const int DIM = (N-1)/2;
-    for (int row = 0; row < DIM; ++ row)
-    for (int col = 0; col < DIM; ++col) {
-        auto hole = *holes[row][col];
-        for (int r = 0; r < 3; ++r)
-        for (int c = 0; c < 3; ++c)
-            answer[2*row+r][2*col+c] = hole.cells[r][c];
+struct SharedFirstTwo {
+    // The same for the workers of a parallel search, any of which may
+    // find a solution; once there are two, every worker stops.
+    std::mutex lock;
+    std::atomic<int> solutions {0};
+    SwissSquares<N> answer;
+    bool found(const HoleSquare<N>& soln) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (answer.size() < 2)
+            answer.push_back(holes2Square<N>(soln));
+        solutions = answer.size();
+        return answer.size() == 2;
     }
-    return answer;
-}
+    bool stopped() const {return solutions.load(std::memory_order_relaxed) >= 2;}
+};
+
+template <int N>
+struct SearchState {
+    // Everything a backtrack search changes.  The hole catalog is only
+    // read, so any number of SearchStates can share one.
+    
+    static const int DIM = (N-1)/2;    // dimension of square of holes
+    static const int LEVELS = 1+(N-1)*(N-1)/4;
+    const HoleCatalog& holes;          // holes[sum] is the HoleList for sum
+    Givens<N> clues;
+    Board<N> board;                    // holes placed at levels 1 to level-1
+    std::array<Entry<N>, LEVELS> Stack;
+    struct Domain {
+        // What best() found of an empty hole's candidates: n of them
+        // fit, or at least -n if it stopped counting.  list has the ones
+        // it found, and any it had yet to look at again, in order, and
+        // [rest, stop) the ones it had yet to look at.
+        int n;
+        const unsigned* list;
+        int length;
+        const unsigned* rest;
+        const unsigned* stop;
+    };
+    using Domains = std::array<std::array<Domain, DIM>, DIM>;
+    std::array<Domains, LEVELS> domains;    // of the empty holes when
+                                            // Stack[level] was chosen
+    std::array<std::vector<unsigned>, LEVELS> kept; // and their lists
+    Givens<N> touches;                 // filled holes next to each hole
+    std::array<int, DIM> rowHoles;     // filled holes in each row
+    std::array<int, DIM> colHoles;     // and each column
+    long int count;                    // number of holes inspected
+    SearchStats<N> stats;              // empty unless SWISS_STATS
+    
+    explicit SearchState(const HoleCatalog& holes) : holes(holes) {}
+    SwissSquares<N> search(const Givens<N>& hints);
+    SwissSquares<N> another(const Givens<N>& hints,
+                            const SwissSquare<N>& known);
+    void start(const Givens<N>& hints);
+    bool descend(int level, const unsigned* c);
+    void retract(int level);
+    template <typename Sink>
+    bool explore(int level, Sink& sink);
+    bool best(int level);
+    bool constrain(int level);
+    void narrow(Entry<N>& entry);
+    void mark(int row, int col, int step);
+};
 
 template <int N>
 struct Solver {
     // Solves Swiss Square puzzle of fixed dimension N
-    // There is no destructor for the Holelist, because
-    // the Solver's lifetime will be the lifetime of the
-    // program, so the OS will clean up.  A destructor
-    // would just be an opportunity to make programming errors.
+    static_assert(N % 2 == 1 and N <= 15,
+                  "symbols are stored in four bits, so go up to 15");
     
     static const int DIM = (N-1)/2;    // dimension of square of holes
-    HoleList holes[8*N-6];             // maximum central sum is 8*N-7
-    Givens<N> clues;
-    std::array<Entry<N>,1+(N-1)*(N-1)/4> Stack;
+    static const int SUMS = 8*N-6;     // maximum central sum is 8*N-7
+    static const int SPLIT = DIM*DIM > 2 ? 2 : DIM*DIM-1;
+                                       // levels a parallel search splits
+    HoleCatalog holes;                 // holes[sum] is the HoleList for sum;
+                                       // never changed after construction,
+                                       // so SearchStates on any thread
+                                       // may share it
+    SearchState<N> state {holes};
     long int count;                    // number of holes inspected
     
-    Solver();
+    // Holes come from the compiled tables if there are any for N.
+    // Otherwise catalog names the persistent hole catalog file; the
+    // holes are generated and the file written if it is missing or out
+    // of date.  An empty name means never write, and generate the holes
+    // with each central sum only when a puzzle first has it as a clue.
+    explicit Solver(const std::string& catalog = defaultCatalog());
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
+    static std::string defaultCatalog();
+    static void generate(int sum, std::vector<Hole>& found);
     int makeHoles();
-    Coords best(int level);
-    void constrain(int level);
     SwissSquares<N> search(Givens<N>& hints);
+    SwissSquares<N> search(Givens<N>& hints, int threads);
+    SwissSquares<N> another(Givens<N>& hints, const SwissSquare<N>& known);
+private:
+    using Task = std::array<long, SPLIT>;  // the candidate at each level,
+                                           // as how far it is from the stop
+    bool next(int& level, Task& task);
 };
 
 template <int N>
-Solver<N>::Solver() {
+Solver<N>::Solver(const std::string& catalog) {
+    if (StaticHoles<N>::attach(holes))
+        return;
+    if (catalog.empty()) {
+        holes.lazy(generate, SUMS);
+        return;
+    }
+    if (mapCatalog(holes, N, SUMS, catalog))
+        return;
     makeHoles();
+    saveCatalog(holes, N, catalog);
+}
+
+template <int N>
+std::string Solver<N>::defaultCatalog() {
+    return "swiss" + std::to_string(N) + ".holes";
 }
 
 template <int N>
 int Solver<N>::makeHoles() {
-    int answer;        // number of holes found
+    // Generate every hole at once
+    std::vector<Hole> found;
+    generate(-1, found);
+    holes.build(found, SUMS);
+    return found.size();
+}
+
+template <int N>
+void Solver<N>::generate(int sum, std::vector<Hole>& found) {
+    // Append the holes with central sum to found, or all of them if
+    // sum is negative, in the same order either way.  The cells left
+    // to fill hold at least 1 and at most N each, so a partial hole
+    // whose sum cannot reach sum is not filled in any further, and the
+    // last cell is whatever makes up the sum.
     int cell[8];       // numbers assigned to the cells
+    int partial[9];    // sum of the cells before each level
     Set<N> S[9];       // possible values for each of the cells
     int level = 0;     // for backtracking
+    partial[0] = 0;
     S[0].set();
     S[0].reset(0);
     S[8].reset();     // sentinel
@@ -73,18 +199,19 @@ int Solver<N>::makeHoles() {
             while (S[level][i] == 0) ++i;
             cell[level] = i;
             S[level].reset(i);
-            level += 1;
-            if (level == 8) {
-                answer += 1;
-                auto hole = new Hole(cell);
-                int s = hole->sum;
-                holes[s].all.push_back(hole);
-                holes[s].tops[hole->top].push_back(hole);
-                holes[s].bottoms[hole->bottom].push_back(hole);
-                holes[s].lefts[hole->left].push_back(hole);
-                holes[s].rights[hole->right].push_back(hole);
-                holes[s].count++;
+            if (sum >= 0) {
+                int rest = 7 - level;
+                if (partial[level] + i + rest > sum) {
+                    S[level].reset();       // larger i are no better
+                    continue;
+                }
+                if (partial[level] + i + N*rest < sum)
+                    continue;
             }
+            partial[level+1] = partial[level] + i;
+            level += 1;
+            if (level == 8)
+                found.push_back(Hole(cell));
             else {
                 // compute S[level]
                 S[level].set();
@@ -117,21 +244,26 @@ int Solver<N>::makeHoles() {
                         S[7].reset(cell[0]);
                         S[7].reset(cell[3]);
                         S[7].reset(cell[6]);
+                        if (sum >= 0) {
+                            // the last cell makes up the sum
+                            int last = sum - partial[7];
+                            bool fits = last > 0 and last <= N and S[7][last];
+                            S[7].reset();
+                            if (fits)
+                                S[7].set(last);
+                        }
                         break;
                 }
             }
         }
         level -= 1;   //backtrack
     }
-    return answer;
 }
 
 template <int N>
-SwissSquares<N>
-Solver<N>::search(Givens<N>& hints){
+void SearchState<N>::start(const Givens<N>& hints) {
+    // Set up level 1 for a new puzzle
     clues = hints;
-    SwissSquares<N> answer;
-    int level = 1;
     int min = 1000000000;  // INFINITY
     int sum =  0;
     count = 0;
@@ -144,193 +276,380 @@ Solver<N>::search(Givens<N>& hints){
             current->row = r;
             current->col = c;
         }
-        current->filled[r][c] = 0;   // erase results from prior puzzle
     }
+    board = Board<N>();    // erase results from prior puzzle
+    touches = Givens<N>();
+    rowHoles = {};
+    colHoles = {};
+    current->overlaps.clear();
+    current->updateFilter(board);
     int hint = clues[current->row][current->col];
-    current->candidates = holes[hint].all.begin();
-    current->stop =       holes[hint].all.end();
-    
-    while (level > 0) {
+    current->pool =       holes[hint].pool;
+    current->candidates = holes[hint].all().begin();
+    current->stop =       holes[hint].all().end();
+}
+
+template <int N>
+bool SearchState<N>::descend(int level, const unsigned* c) {
+    // Place candidate c at this level and set up the next one.  If that
+    // leaves some empty hole with no candidates, take c off again and
+    // return false.
+    auto current = &Stack[level];
+    current->candidates = c+1;
+    current->placed = board.place(current->row, current->col,
+                                  current->pool + *c);
+    mark(current->row, current->col, 1);
+    stats.node(level);
+    if (not constrain(level+1)) {
+        stats.deadEnd();
+        retract(level);
+        return false;
+    }
+    return true;
+}
+
+template <int N>
+void SearchState<N>::retract(int level) {
+    // Take off the hole placed at this level
+    auto current = &Stack[level];
+    board.remove(current->row, current->col, current->placed);
+    mark(current->row, current->col, -1);
+}
+
+template <int N>
+void SearchState<N>::mark(int row, int col, int step) {
+    // Count a hole at (row, col) as filled (step 1) or empty (step -1)
+    if (row > 0) touches[row-1][col] += step;
+    if (row < DIM-1) touches[row+1][col] += step;
+    if (col > 0) touches[row][col-1] += step;
+    if (col < DIM-1) touches[row][col+1] += step;
+    rowHoles[row] += step;
+    colHoles[col] += step;
+}
+
+template <int N>
+template <typename Sink>
+bool SearchState<N>::explore(int level, Sink& sink) {
+    // Search the candidates left at this level and everything below
+    // them, passing each solution to sink.  Returns true if the sink
+    // stopped the search.
+    int floor = level;
+    auto current = &Stack[level];
+    while (level >= floor) {
         while (current->candidates != current->stop) {
-            auto c = current->candidates;
-            while (c < current->stop and not current->suitable(*c) )
-                c++;
+            if (sink.stopped())
+                return true;
+            auto c = current->filter.first(current->pool,
+                                           current->candidates, current->stop);
             count += 1 + (c - current->candidates); // update holes inspected count
+            stats.scan(current->filter, current->pool, current->candidates,
+                       c, current->stop);
             if (c == current->stop) break;          // backtrack
-            int r1 = current->row;
-            int c1 = current->col;
-            current->filled[r1][c1] = *c;
-            current->candidates = c+1;
             if (level == DIM*DIM) {
-                auto soln = current->filled;
-                soln[r1][c1] = *c;
-                answer.push_back(holes2Square<N>(soln));
-                if (answer.size() == 2)
-                    return answer;
+                current->candidates = c+1;
+                stats.node(level);
+                auto soln = board.filled;
+                soln[current->row][current->col] = current->pool + *c;
+                if (sink.found(soln))
+                    return true;
             }
-            else {
+            else if (descend(level, c)) {
                 level += 1;
-                Stack[level] = Stack[level-1];
                 current = &Stack[level];
-                constrain(level);
             }
         }
         level = level-1;
         current = &Stack[level];
+        if (level > 0)
+            retract(level);
     }
+    return false;
+}
+
+template <int N>
+SwissSquares<N>
+SearchState<N>::search(const Givens<N>& hints){
+    // Up to two solutions, in the order the search finds them
+    FirstTwo<N> solutions;
+    stats.begin(stats.SEARCH);
+    start(hints);
+    explore(1, solutions);
+    stats.end(stats.SEARCH);
+    return solutions.answer;
+}
+
+template <int N>
+SwissSquares<N>
+SearchState<N>::another(const Givens<N>& hints, const SwissSquare<N>& known){
+    // A solution of hints other than known, which must be one, or none
+    // if known is the only solution.  The centres of known need not be
+    // zero.  A swap between two lines of known is tried before any
+    // search, and count is 0 if one is found.
+    SwissSquare<N> other;
+    count = 0;
+    stats.begin(stats.SWAP);
+    bool swapped = localSwap<N>(known, other);
+    stats.end(stats.SWAP);
+    if (swapped)
+        return {other};
+    OtherThan<N> solutions {holesOut<N>(known), {}};
+    stats.begin(stats.SEARCH);
+    start(hints);
+    explore(1, solutions);
+    stats.end(stats.SEARCH);
+    return solutions.answer;
+}
+
+template <int N>
+SwissSquares<N>
+Solver<N>::search(Givens<N>& hints){
+    auto answer = state.search(hints);
+    count = state.count;
     return answer;
 }
 
-template<int N>
-Coords Solver<N>::best(int level) {
-    /* Returns the coordinates of the next empty hole to fill 
-     at this level.  This is the heart of the matter.
-     Uses the following heuristic:
-     1. Return the coordinates of a hole touching the greatest
-     number of filled holes, provided it touches at least two.
-     2. Return the cordinates of an empty hole in a maximally-
-     filled row or column, provided there is more than one
-     filled hole in that line.  The empty hole must touch
-     a filled hole.
-     3. Otherwise, among all empty holes adjacent to a filled
-     hole, return the coordinates of the one where the
-     combination of the clue and the constraint give the
-     smallest number of possibilities.
-     */
-    Coords answer;
-    auto & filled = Stack[level].filled;
-    Givens<N> touches {};
-    for (int r = 0; r< DIM; ++r)
-    for (int c = 0; c < DIM; ++c) {
-        if (not filled[r][c]) continue;
-        if (r > 0) touches[r-1][c] +=1;
-        if (r < DIM-1) touches[r+1][c] +=1;
-        if (c > 0) touches[r][c-1] +=1;
-        if (c < DIM-1) touches[r][c+1] +=1;
-    }
-    
-    int max = 0;
-    for (int r = 0; r < DIM; ++ r)
-    for (int c = 0; c < DIM; c++) {
-        if (not filled[r][c] and touches[r][c] > max) {
-            max = touches[r][c];
-            answer =  Coords(r,c);
+template <int N>
+SwissSquares<N>
+Solver<N>::another(Givens<N>& hints, const SwissSquare<N>& known){
+    auto answer = state.another(hints, known);
+    count = state.count;
+    return answer;
+}
+
+template <int N>
+bool Solver<N>::next(int& level, Task& task) {
+    // Move state on to the next candidate at level SPLIT, placing holes
+    // at the levels above it as explore would, and put the candidates
+    // at levels 1 to SPLIT, each one before its level's next, in task.  level is where the last call left
+    // off, 1 at first.  Returns false when there are no more.
+    while (level > 0) {
+        auto current = &state.Stack[level];
+        auto c = current->filter.first(current->pool, current->candidates,
+                                       current->stop);
+        state.count += 1 + (c - current->candidates);
+        if (c == current->stop) {
+            level -= 1;
+            if (level > 0)
+                state.retract(level);
+            continue;
         }
-    }
-    if ( max > 1) return answer;   // Heuristic 1
-    
-    std::array<int, DIM> rowHoles {};
-    std::array<int, DIM> colHoles {};
-    
-    for (int r = 0; r < DIM; ++r)
-    for (int c = 0; c < DIM; ++c) {
-        if (filled[r][c]) {
-            rowHoles[r] += 1;
-            colHoles[c] += 1;
+        if (level == SPLIT) {
+            current->candidates = c+1;
+            for (int k = 1; k <= SPLIT; ++k)
+                task[k-1] = state.Stack[k].stop - (state.Stack[k].candidates - 1);
+            return true;
         }
+        if (state.descend(level, c))
+            level += 1;
     }
-    
-    max = 0;
-    for (int r = 0; r < DIM; ++r)
-    for (int c = 0; c < DIM; ++ c) {
-        if (not touches[r][c] or filled[r][c]) continue;
-        if (rowHoles[r] > max and rowHoles[r] < DIM) {
-            max = rowHoles[r];
-            answer = Coords(r,c);
-        }
-        if (colHoles[c] > max and colHoles[c] < DIM) {
-            max = colHoles[c];
-            answer = Coords(r,c);
-        }
+    return false;
+}
+
+template <int N>
+SwissSquares<N>
+Solver<N>::search(Givens<N>& hints, int threads){
+    // Parallel search with the given number of threads.  Finds the same
+    // number of solutions as search(hints), and the same solution if it
+    // is unique, but when there are two or more it may find different
+    // ones.  count is the total over all the threads.  The subtrees
+    // below levels 1 to SPLIT are made one at a time, in the order
+    // search(hints) meets them, as workers become free, so a search that
+    // stops at two solutions makes only the ones it reached.
+    if (threads < 2 or SPLIT < 1)
+        return search(hints);
+    WorkPool<Task> pool(threads);
+    SharedFirstTwo<N> solutions;
+    int level = 1;
+    state.start(hints);
+
+    std::vector<std::unique_ptr<SearchState<N>>> states;
+    std::vector<Task> held(threads);        // candidates each state has
+                                            // placed above SPLIT
+    std::vector<long int> counts(threads);
+    for (int w = 0; w < threads; ++w) {
+        states.emplace_back(new SearchState<N>(holes));
+        states[w]->start(hints);
     }
-    if (max > 1) return answer;    // Heuristic 2
-    
-    size_t min {1000000000};   // INFINITY
+    pool.run([&](Task& task) {
+        return not solutions.stopped() and next(level, task);
+    }, [&](int w, const Task& task) {
+        // The holes above SPLIT stay placed from the worker's last task,
+        // and are only placed again when this one differs there
+        auto & s = *states[w];
+        if (not std::equal(task.begin(), task.end()-1, held[w].begin())) {
+            counts[w] += s.count;
+            s.start(hints);
+            for (int level = 1; level < SPLIT; ++level)     // next() checked
+                s.descend(level, s.Stack[level].stop - task[level-1]);
+            held[w] = task;
+        }
+        bool stopped = false;
+        if (s.descend(SPLIT, s.Stack[SPLIT].stop - task[SPLIT-1]))
+            stopped = s.explore(SPLIT+1, solutions);
+        return not stopped;
+    });
+    count = state.count;
+    for (int w = 0; w < threads; ++w)
+        count += counts[w] + states[w]->count;
+    for (auto & s : states)
+        state.stats += s->stats;
+    return solutions.answer;
+}
+
+template<int N>
+bool SearchState<N>::best(int level) {
+    /* Sets up Stack[level] for the empty hole to fill at this level.
+     This is the heart of the matter.  Every empty hole touching a
+     filled hole is a choice, and the one with the fewest candidates
+     that meet all its constraints is taken.  Ties are broken by the
+     old heuristics:
+     1. the hole touching the greater number of filled holes,
+     2. then the hole in the row or column with more filled holes,
+     provided it is not full,
+     3. then the hole with fewer holes matching its sides, before
+     Latinity is checked.
+     Candidates are only counted as far as they need to be to lose to
+     the best so far.  Returns false if some empty hole touching a
+     filled one has no candidates, in which case this branch is dead.
+
+     Placing a hole only takes candidates away, so each hole's domain
+     at the level above is where its count starts.  A hole the hole
+     placed there is not next to, and shares no row or column of cells
+     with, keeps its count as it was.  The chosen hole's candidates are
+     its list, which then has just the ones that fit.
+     */
+    auto & filled = board.filled;
+    auto & next = Stack[level];
+    auto & placed = Stack[level-1];
+    auto & known = domains[level];
+    auto & buffer = kept[level];
+    Givens<N> at;           // where in buffer each new list starts
+    Entry<N> probe;
+    int min = 1000000000;   // INFINITY
+    int lines = 0;
+    size_t size = 0;
+    buffer.clear();
+    // The holes touching more filled holes usually have fewer
+    // candidates, so they go first, to cut the counting short sooner.
+    for (int t = 4; t > 0; --t)
     for (int r = 0; r < DIM; ++r)
     for (int c = 0; c < DIM; ++c) {
-        if (not touches[r][c] or filled[r][c]) continue;
-        int hint = clues[r][c];
-        int top = r-1;
-        int bottom = r+1;
-        int left = c-1;
-        int right = c+1;
-        if (top >= 0 and filled[top][c]) {
-            auto nbr = filled[top][c];
-            size_t pop = holes[hint].tops[nbr->bottom].size();
-            if (pop < min) {
-                min = pop;
-                answer = Coords(r,c);
-            }
-        }
-        else if (bottom < DIM and filled[bottom][c]){
-            auto nbr = filled[bottom][c];
-            size_t pop = holes[hint].bottoms[nbr->top].size();
-            if (pop < min) {
-                min = pop;
-                answer = Coords(r,c);
+        if (filled[r][c] or touches[r][c] != t) continue;
+        int dr = std::abs(r - placed.row);
+        int dc = std::abs(c - placed.col);
+        bool had = touches[r][c] > (dr + dc == 1);  // a domain above
+        auto & domain = known[r][c];
+        domain = had ? domains[level-1][r][c] : Domain {-1, nullptr, 0};
+        at[r][c] = -1;
+        bool same = had and dr > 1 and dc > 1;
+        if (same and -domain.n > min) continue;
+        probe.row = r;
+        probe.col = c;
+        narrow(probe);
+        int n = domain.n;
+        if (not same or n < 0) {
+            auto list = domain.list;
+            auto end = list + domain.length;
+            auto rest = probe.candidates;
+            auto stop = probe.stop;
+            if (had and domain.length + (domain.stop - domain.rest)
+                        < stop - rest) {
+                rest = domain.rest;
+                stop = domain.stop;
             }
+            else
+                list = end = nullptr;
+            at[r][c] = buffer.size();
+            n = probe.filter.collect(probe.pool, list, end, min + 1, count,
+                                     buffer);
+            if (n > min)
+                buffer.insert(buffer.end(), list, end);
+            else
+                n += probe.filter.collect(probe.pool, rest, stop, min + 1 - n,
+                                          count, buffer);
+            if (n == 0)
+                return false;
+            domain = {n > min ? -n : n, nullptr,
+                      int(buffer.size()) - at[r][c], rest, stop};
         }
-        else if (left >= 0 and filled[r][left]) {
-            auto nbr = filled[r][left];
-            size_t pop = holes[hint].lefts[nbr->right].size();
-            if (pop < min) {
-                min = pop;
-                answer = Coords(r,c);
-            }
-        }
-        else {
-            auto nbr = filled[r][right];
-            size_t pop = holes[hint].rights[nbr->left].size();
-            if (pop < min) {
-                min = pop;
-                answer = Coords(r,c);
+        if (n > min) continue;
+        int line = 0;
+        if (rowHoles[r] < DIM) line = rowHoles[r];
+        if (colHoles[c] < DIM) line = std::max(line, colHoles[c]);
+        size_t pop = probe.stop - probe.candidates;
+        if (n == min) {     // next touches at least t filled holes
+            if (touches[next.row][next.col] > t) {
+                stats.tie(1);
+                continue;
             }
+            stats.tie(line != lines ? 2 : 3);
+            if (line < lines) continue;
+            if (line == lines and pop >= size) continue;
         }
+        min = n;
+        lines = line;
+        size = pop;
+        next = probe;
     }
-    return answer;  // Heuristic 3
+    // buffer is complete, so the new lists can be pointed to
+    for (int r = 0; r < DIM; ++r)
+    for (int c = 0; c < DIM; ++c)
+        if (at[r][c] >= 0)
+            known[r][c].list = buffer.data() + at[r][c];
+    next.candidates = known[next.row][next.col].list;
+    next.stop = next.candidates + min;
+    return true;
 }
 
 template<int N>
-void Solver<N>::constrain(int level){
-    // 1. Update row and column preclusions
-    // 2. Choose the next hole as the one that seems hardest to fill
-    // 3. Work out the constraints on the new hole
-    //const int DIM = (N-1)/2;
-    auto & current = Stack[level];
-    auto & old = Stack[level-1];
-    current.updateCells(old);
-    auto coords = best(level);
-    
-    current.overlaps.clear();
-    auto & filled = current.filled;
-    int row = current.row = coords.first;
-    int col = current.col = coords.second;
-    int hint = clues[current.row][current.col];
+bool SearchState<N>::constrain(int level){
+    // Choose the next hole as the one that is hardest to fill, and work
+    // out its constraints.  Returns false if the branch is dead.
+    long counted = count;
+    stats.begin(stats.BEST);
+    bool alive = best(level);
+    stats.end(stats.BEST);
+    stats.probe(count - counted);
+    return alive;
+}
+
+template<int N>
+void SearchState<N>::narrow(Entry<N>& entry){
+    // Work out the constraints, candidates and filter for the empty
+    // hole at entry's position, which must touch a filled hole
+    entry.overlaps.clear();
+    auto & filled = board.filled;
+    int row = entry.row;
+    int col = entry.col;
+    int hint = clues[row][col];
     if (row > 0 and filled[row-1][col]) {
         // hole above is filled; its bottom is our top
-        int v = filled[row-1][col]->bottom;
-        auto c = holes[hint].tops[v].size();
-        current.overlaps.push_back(Constraint('t',v,c));
+        int v = filled[row-1][col]->bottom();
+        auto c = holes[hint].tops(v).size();
+        entry.overlaps.push_back(Constraint(TOP,v,c));
     }
     if (row+1 < DIM and filled[row+1][col]) {
         // hole below is filled; its top is our bottom
-        int v = filled[row+1][col]->top;
-        auto c = holes[hint].bottoms[v].size();
-        current.overlaps.push_back(Constraint('b', v, c));
+        int v = filled[row+1][col]->top();
+        auto c = holes[hint].bottoms(v).size();
+        entry.overlaps.push_back(Constraint(BOTTOM, v, c));
     }
     if (col > 0 and filled[row][col-1]) {
         // hole to the left is filled; its right is our left
-        int v = filled[row][col-1]->right;
-        auto c = holes[hint].lefts[v].size();
-        current.overlaps.push_back(Constraint('l',v,c));
+        int v = filled[row][col-1]->right();
+        auto c = holes[hint].lefts(v).size();
+        entry.overlaps.push_back(Constraint(LEFT,v,c));
     }
     if (col+1 < DIM and filled[row][col+1]) {
         // hole to the right is filled; its left is our right
-        int v = filled[row][col+1]->left;
-        auto c = holes[hint].rights[v].size();
-        current.overlaps.push_back(Constraint('r',v,c));
+        int v = filled[row][col+1]->left();
+        auto c = holes[hint].rights(v).size();
+        entry.overlaps.push_back(Constraint(RIGHT,v,c));
     }
-    auto & overlaps = current.overlaps;
+    // The filter checks every side, so that it also serves for a list
+    // of candidates made before some of the sides were fixed
+    entry.updateFilter(board);
+    auto & overlaps = entry.overlaps;
     std::sort(overlaps.begin(), overlaps.end(),
                [ ](Constraint& a, Constraint& b) {
                    return a.count > b.count;
@@ -338,25 +657,22 @@ void Solver<N>::constrain(int level){
     auto least = overlaps.back();   // most restrictive constraint
     overlaps.pop_back();
     std::reverse(overlaps.begin(), overlaps.end());
-    switch (least.side) {
-        case 't':
-            current.candidates = holes[hint].tops[least.value].begin();
-            current.stop =       holes[hint].tops[least.value].end();
-            break;
-        case 'b':
-            current.candidates = holes[hint].bottoms[least.value].begin();
-            current.stop =       holes[hint].bottoms[least.value].end();
-            break;
-        case 'l':
-            current.candidates = holes[hint].lefts[least.value].begin();
-            current.stop =       holes[hint].lefts[least.value].end();
-            break;
-        case 'r':
-            current.candidates = holes[hint].rights[least.value].begin();
-            current.stop =       holes[hint].rights[least.value].end();
-            break;
+    HoleRange range = holes[hint].side(least.side, least.value);
+    // If other sides are fixed too, take the one that together with
+    // least leaves the fewest holes
+    int other = -1;
+    for (int i = 0; i < overlaps.size; ++i) {
+        auto & o = overlaps.items[i];
+        auto r = holes[hint].sides(least.side, least.value, o.side, o.value);
+        if (other < 0 or r.size() < range.size()) {
+            range = r;
+            other = i;
+        }
     }
-    
+    entry.pool =       holes[hint].pool;
+    entry.candidates = range.begin();
+    entry.stop =       range.end();
 }
+
 #endif
 
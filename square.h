@@ -0,0 +1,59 @@
+//
+//  square.h
+//
+//  Swiss squares, and going between them and their holes and clues.
+//
+
+#ifndef square_h
+#define square_h
+
+#include <vector>
+#include "entry.h"
+
+template <int N>
+using SwissSquare = std::array<std::array<int, N>, N>;
+template <int N>
+using SwissSquares = std::vector<SwissSquare<N>>;
+
+template <int N>
+SwissSquare<N> holes2Square(const HoleSquare<N>& holes){
+    SwissSquare<N> answer;
+    const int DIM = (N-1)/2;
+    for (int row = 0; row < DIM; ++ row)
+    for (int col = 0; col < DIM; ++col) {
+        auto hole = *holes[row][col];
+        for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 3; ++c)
+            answer[2*row+r][2*col+c] = hole.cell(r, c);
+    }
+    return answer;
+}
+
+template<int N>
+Givens<N> square2Clues(const SwissSquare<N>& soln) {
+    // The clues of a square; its centres need not be zero
+    Givens<N> answer {};
+    const int DIM = (N-1)/2;
+    
+    for (int r = 0; r < DIM; ++r)
+    for (int c = 0; c < DIM; ++c) {
+        int rowCenter = 2*r+1;
+        int colCenter = 2*c+1;
+        for (int i=-1; i <=1; ++i)
+        for (int j=-1; j <= 1; ++j)
+            answer[r][c] += soln[rowCenter+i][colCenter+j];
+        answer[r][c] -= soln[rowCenter][colCenter];
+    }
+    return answer;
+}
+
+template <int N>
+SwissSquare<N> holesOut(SwissSquare<N> square) {
+    // square with the centres of its holes made zero
+    for (int r = 1; r < N; r += 2)
+    for (int c = 1; c < N; c += 2)
+        square[r][c] = 0;
+    return square;
+}
+
+#endif /* square_h */
@@ -0,0 +1,134 @@
+//
+//  stats.h
+//
+//  Counters for finding where the search spends its time.  They are
+//  compiled in only with -DSWISS_STATS=1.  Otherwise SearchStats is
+//  empty and its methods do nothing, so the search compiles to what it
+//  was without them.
+//
+//      nodes[level]    holes placed at each level, those at the last
+//                      level being solutions
+//      scanned         candidates explore looked at
+//      accepted        and those that fit
+//      probed          candidates best() looked at while counting the
+//                      empty holes, which with scanned makes up the
+//                      solver's count of holes inspected
+//      sides, latin    the others, rejected for a side that does not
+//                      match a filled neighbour, or else for repeating
+//                      a symbol in a row or column
+//      dead            holes placed that left an empty hole with no
+//                      candidates
+//      ties[k]         times best() broke a tie between holes with
+//                      equally few candidates by its rule k+1
+//      seconds         time in the swap test before a search, in the
+//                      search itself, and the part of that spent in
+//                      best()
+//
+
+#ifndef stats_h
+#define stats_h
+
+#ifndef SWISS_STATS
+#define SWISS_STATS 0
+#endif
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include "filter.h"
+
+template <int N>
+struct SearchStats {
+    static const int LEVELS = 1+(N-1)*(N-1)/4;
+    enum Phase {SWAP, SEARCH, BEST, PHASES};
+#if SWISS_STATS
+    using Clock = std::chrono::steady_clock;
+    std::array<long, LEVELS> nodes {};
+    long scanned {0};
+    long accepted {0};
+    long sides {0};
+    long latin {0};
+    long probed {0};
+    long dead {0};
+    std::array<long, 3> ties {};
+    std::array<double, PHASES> seconds {};
+    std::array<Clock::time_point, PHASES> began;  // phases may nest
+
+    void node(int level) {nodes[level] += 1;}
+    void deadEnd() {dead += 1;}
+    void probe(long holes) {probed += holes;}
+    void tie(int rule) {ties[rule-1] += 1;}
+    void begin(Phase phase) {began[phase] = Clock::now();}
+    void end(Phase phase) {
+        seconds[phase] += std::chrono::duration<double>(Clock::now() - began[phase]).count();
+    }
+    void scan(const HoleFilter& filter, const Hole* pool, const unsigned* c,
+              const unsigned* found, const unsigned* stop);
+    SearchStats& operator+=(const SearchStats& other);
+    void json(std::ostream& out) const;
+#else
+    void node(int) {}
+    void deadEnd() {}
+    void probe(long) {}
+    void tie(int) {}
+    void begin(Phase) {}
+    void end(Phase) {}
+    void scan(const HoleFilter&, const Hole*, const unsigned*,
+              const unsigned*, const unsigned*) {}
+    SearchStats& operator+=(const SearchStats&) {return *this;}
+    void json(std::ostream&) const {}
+#endif
+};
+
+#if SWISS_STATS
+
+template <int N>
+void SearchStats<N>::scan(const HoleFilter& filter, const Hole* pool,
+                          const unsigned* c, const unsigned* found,
+                          const unsigned* stop) {
+    // Count a scan from c that stopped at found, which fits unless it
+    // is stop; the candidates before it were rejected
+    scanned += (found - c) + (found != stop);
+    accepted += found != stop;
+    for (; c != found; ++c)
+        if (filter.matches(pool[*c]))
+            latin += 1;
+        else
+            sides += 1;
+}
+
+template <int N>
+SearchStats<N>& SearchStats<N>::operator+=(const SearchStats& other) {
+    for (int k = 0; k < LEVELS; ++k)
+        nodes[k] += other.nodes[k];
+    scanned += other.scanned;
+    accepted += other.accepted;
+    sides += other.sides;
+    latin += other.latin;
+    probed += other.probed;
+    dead += other.dead;
+    for (int k = 0; k < 3; ++k)
+        ties[k] += other.ties[k];
+    for (int k = 0; k < PHASES; ++k)
+        seconds[k] += other.seconds[k];
+    return *this;
+}
+
+template <int N>
+void SearchStats<N>::json(std::ostream& out) const {
+    // Write the counters as a "search" member of an enclosing object,
+    // with its leading comma
+    out << ",\"search\":{\"nodes\":[";
+    for (int k = 1; k < LEVELS; ++k)
+        out << (k > 1 ? "," : "") << nodes[k];
+    out << "],\"scanned\":" << scanned << ",\"accepted\":" << accepted
+        << ",\"sides\":" << sides << ",\"latin\":" << latin
+        << ",\"probed\":" << probed << ",\"dead\":" << dead << ",\"ties\":[" << ties[0] << ","
+        << ties[1] << "," << ties[2] << "],\"swap_s\":" << seconds[SWAP]
+        << ",\"search_s\":" << seconds[SEARCH]
+        << ",\"best_s\":" << seconds[BEST] << "}";
+}
+
+#endif
+
+#endif /* stats_h */
@@ -0,0 +1,87 @@
+//
+//  swaps.h
+//
+//  Quick ways to show that a puzzle with a known solution has another.
+//  Take two rows of the solution.  Starting from a column where both
+//  have a symbol, follow the symbol in the second row to the column
+//  where the first row has it, and so on, until the path comes back to
+//  where it started.  Swapping the two rows' symbols in the columns of
+//  that cycle leaves both rows and every column with the symbols they
+//  had, so the result is another Swiss square; if it also keeps every
+//  hole's sum, it solves the same puzzle.  A 2x2 Latin subsquare is a
+//  cycle of two columns.  The same goes for two columns, by symmetry.
+//
+//  Most puzzles that are not unique have such a swap, and looking for
+//  one takes a few thousand steps, much less than any search.
+//
+
+#ifndef swaps_h
+#define swaps_h
+
+#include "square.h"
+
+template <int N>
+SwissSquare<N> transpose(const SwissSquare<N>& square) {
+    SwissSquare<N> answer;
+    for (int r = 0; r < N; ++r)
+    for (int c = 0; c < N; ++c)
+        answer[c][r] = square[r][c];
+    return answer;
+}
+
+template <int N>
+bool rowSwap(const SwissSquare<N>& known, SwissSquare<N>& other) {
+    // Look for a cycle between two rows of known, which must have its
+    // centres zero, that keeps every clue.  If there is one, other is
+    // known with the cycle swapped.
+    auto clues = square2Clues<N>(known);
+    for (int r1 = 0; r1 < N; ++r1)
+    for (int r2 = r1+1; r2 < N; ++r2) {
+        int where[N+1];         // column of each symbol in row r1
+        for (int v = 0; v <= N; ++v)
+            where[v] = -1;
+        for (int c = 0; c < N; ++c)
+            where[known[r1][c]] = c;
+        unsigned seen = 0;      // columns in cycles tried already
+        for (int start = 0; start < N; ++start) {
+            if (seen & 1u << start) continue;
+            unsigned cycle = 0;
+            bool closed = true;
+            int c = start;
+            do {
+                cycle |= 1u << c;
+                if (known[r1][c] == 0 or known[r2][c] == 0) {
+                    closed = false;
+                    break;
+                }
+                c = where[known[r2][c]];
+            } while (c >= 0 and c != start);
+            seen |= cycle;
+            if (not closed or c < 0) continue;
+            other = known;
+            for (int k = 0; k < N; ++k)
+                if (cycle & 1u << k)
+                    std::swap(other[r1][k], other[r2][k]);
+            if (square2Clues<N>(other) == clues)
+                return true;
+        }
+    }
+    return false;
+}
+
+template <int N>
+bool localSwap(const SwissSquare<N>& known, SwissSquare<N>& other) {
+    // Look for a cycle between two rows or two columns of known that
+    // keeps every clue, and make it in other.  The centres of known
+    // need not be zero.
+    auto square = holesOut<N>(known);
+    if (rowSwap<N>(square, other))
+        return true;
+    if (rowSwap<N>(transpose<N>(square), other)) {
+        other = transpose<N>(other);
+        return true;
+    }
+    return false;
+}
+
+#endif /* swaps_h */
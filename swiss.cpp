@@ -16,8 +16,19 @@
 #include <fstream>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <set>
+#include <tuple>
 #include "solver.h"
-#include "randomLatin.h"
+#include "randomSwiss.h"
+#include "verdicts.h"
+#include "telemetry.h"
+#include "campaign.h"
+#include "output.h"
 
 using std::cout;
 using std::cerr;
@@ -28,43 +39,8 @@ using std::array;
 using std::vector;
 using std::exit;
 using std::stoi;
-
-template <int N>
-void printClues(const Givens<N>& clues, ostream& out) {
-    for ( auto & row: clues) {
-        for ( auto & clue :row)
-            out << clue << " ";
-        out << endl;
-    }
-    out << endl;
-}
-
-template <int N>
-void printSolution(const SwissSquare<N>& soln, ostream& out) {
-    for (auto & row:soln) {
-        for (auto col:row)
-            out << col << " ";
-        out << endl;
-    }
-    out << endl  << endl;
-}
-
-template<int N>
-Givens<N> square2Clues(const SwissSquare<N>& soln) {
-    Givens<N> answer {};
-    const int DIM = (N-1)/2;
-    
-    for (int r = 0; r < DIM; ++r)
-    for (int c = 0; c < DIM; ++c) {
-        int rowCenter = 2*r+1;
-        int colCenter = 2*c+1;
-        for (int i=-1; i <=1; ++i)
-        for (int j=-1; j <= 1; ++j)
-            answer[r][c] += soln[rowCenter+i][colCenter+j];
-        answer[r][c] -= soln[rowCenter][colCenter];
-    }
-    return answer;
-}
+using std::mutex;
+using std::lock_guard;
 
 template <int N>
 bool audit(const SwissSquare<N>& soln, const Givens<N> & clues) {
@@ -102,43 +78,307 @@ bool audit(const SwissSquare<N>& soln, const Givens<N> & clues) {
     return true;
 }
 
-int main(int argc, char **argv) {
-    if ( argc != 3) {
-        cerr << "Usage " << argv[0] << " trials outfile" << endl;
-        exit(1);
+template <int N>
+struct Tally {
+    // Shared by the workers of a shard
+    mutex lock;                 // held while writing to cout, or using
+                                // telemetry or checkpoint
+    std::atomic<int> next {0};  // next of the shard's streams to run
+    int success = 0;
+    int errors = 0;
+    int repeats = 0;            // puzzles with a verdict already
+    std::set<Givens<N>> writing;    // unique puzzles being written, whose
+                                    // verdicts are not recorded yet
+    Telemetry<N> telemetry;
+};
+
+template <int N>
+void runTrial(SearchState<N>& state, const SwissSquare<N>& square,
+              int stream, int trial, Tally<N>& tally,
+              VerdictCache<N>& verdicts, PuzzleWriter<N>& out) {
+    // Try the puzzle square makes.  One that has been seen before, in
+    // any of its eight orientations, is neither searched nor written
+    // again.  The square solves the puzzle, so the search is only for a
+    // second solution.
+    Givens<N> clues = square2Clues<N>(square);
+    auto key = canonical<N>(clues);
+    if (verdicts.find(key) != VerdictCache<N>::UNKNOWN) {
+        lock_guard<mutex> guard(tally.lock);
+        tally.repeats += 1;
+        return;
+    }
+    auto began = Telemetry<N>::Clock::now();
+    auto other = state.another(clues, square);
+    std::chrono::duration<double> took = Telemetry<N>::Clock::now() - began;
+    {
+        lock_guard<mutex> guard(tally.lock);
+        tally.telemetry.solve(took.count(), state.stats);
+    }
+    if (not other.empty()) {
+        if (not verdicts.record(key, false)) {
+            lock_guard<mutex> guard(tally.lock);
+            tally.repeats += 1;
+        }
+        return;
+    }
+    // The puzzle is written, and flushed, before its verdict is recorded,
+    // so a run killed in between writes it again on resuming rather
+    // than skipping it.  Until then it is claimed in tally.writing, so
+    // that another worker that finds it unique meanwhile leaves it.
+    PuzzleRecord<N> record {clues, square, audit<N>(square, clues),
+                            stream, trial, state.count, took.count()};
+    {
+        lock_guard<mutex> guard(tally.lock);
+        if (verdicts.find(key) != VerdictCache<N>::UNKNOWN
+            or not tally.writing.insert(key).second) {
+            tally.repeats += 1;
+            return;
+        }
+        tally.success += 1;
+        tally.telemetry.success();
+        if (not record.correct)
+            tally.errors++;
     }
-    const int N = 7;
-    int trials = stoi(argv[1]);
-    ofstream fout;
-    
-    fout.open(argv[2], std::fstream::app);
+    out.write(record);
+    out.flush();
+    verdicts.record(key, true);
+    lock_guard<mutex> guard(tally.lock);
+    tally.writing.erase(key);
+}
 
-    if (not fout) {
-        cerr << "Could not open " << argv[2] << " for output."  << endl;
-        exit(1);
+template <int N>
+void runStreams(const Solver<N>& solver, const Campaign& campaign,
+                Tally<N>& tally, Checkpoint& checkpoint,
+                VerdictCache<N>& verdicts, PuzzleWriter<N>& out) {
+    // Run the shard's streams until there are none left, each from where
+    // the checkpoint left it.  Each worker has its own search state, and
+    // shares the solver's hole catalog.  With chain, each puzzle after a
+    // stream's first comes from a single step of the chain.  Progress
+    // goes to cout as telemetry snapshots, and the checkpoint is saved,
+    // when they are due.
+    SearchState<N> state(solver.holes);
+    auto streams = campaign.mine();
+    for (int k = tally.next++; k < int(streams.size()); k = tally.next++) {
+        int stream = streams[k];
+        SwissGenerator<N> gen(Rng::stream(campaign.seed, stream));
+        int trial;
+        {
+            lock_guard<mutex> guard(tally.lock);
+            trial = checkpoint.resume(stream, gen);
+        }
+        for (; trial < campaign.trialsIn(stream); ++trial) {
+            auto square = campaign.chain and trial > 0 ? gen.step() : gen.next();
+            runTrial<N>(state, square, stream, trial, tally, verdicts, out);
+            lock_guard<mutex> guard(tally.lock);
+            tally.telemetry.trial();
+            checkpoint.update(stream, trial+1, gen);
+            if (tally.telemetry.due())
+                tally.telemetry.snapshot(cout);
+            if (checkpoint.due() and not checkpoint.save())
+                cerr << "Could not write the checkpoint." << endl;
+        }
     }
-    
-    Solver<N> solver;
-    LatinGenerator<N> gen;
-    Givens<N> clues;
-    int success = 0;
-    int errors = 0;
-    for (int trial = 0; trial < trials; ++trial) {
-        cout << '\r' << trial+1 << std::flush;
-        clues = square2Clues<N>(gen.next());
-        auto answer = solver.search(clues);
-        if (answer.size()!=1) continue;
-        success += 1;
-        printClues<N>(clues, fout);
-        auto &soln(answer[0]);
-        if (not audit<N>(soln, clues)) {
-            fout << "INCORRECT SOLUTION FOLLOWS"<<endl;
-            errors++;
+}
+
+template <int N>
+int merge(const vector<std::string>& files, Format format) {
+    // Write the puzzles in files[1], files[2], ... to files[0], each
+    // once whatever its orientation, ordered by the least of its
+    // orientations.  Where one puzzle appears more than once the least
+    // of its versions is kept, so the result does not depend on the
+    // order of the files.  The inputs may be in any format, and each
+    // solution is audited again.  An input with no puzzles, or with
+    // some that are not N by N, as when --size is wrong, is an error,
+    // and files[0] is left as it was.
+    std::map<Givens<N>, PuzzleRecord<N>> puzzles;
+    for (size_t k = 1; k < files.size(); ++k) {
+        std::ifstream in(files[k], std::ios::binary);
+        PuzzleReader<N> reader(in);
+        PuzzleRecord<N> record;
+        size_t read = 0;
+        while (reader.next(record)) {
+            read += 1;
+            record.correct = audit<N>(record.solution, record.clues);
+            auto key = canonical<N>(record.clues);
+            auto found = puzzles.find(key);
+            if (found == puzzles.end())
+                puzzles.emplace(key, record);
+            else if (std::tie(record.clues, record.solution)
+                     < std::tie(found->second.clues, found->second.solution))
+                found->second = record;
+        }
+        if (not reader.good or read == 0) {
+            cerr << "Could not read " << files[k] << " as " << N << "x" << N
+                 << " puzzles." << endl;
+            return 1;
         }
-        printSolution<N>(soln, fout);
     }
-    cout << endl;
-    cout << success << " successes in " << trials << " trials." << endl;
-    cout << errors << " errors encountered." << endl;
+    PuzzleWriter<N> out(files[0], format, false);
+    for (auto & puzzle : puzzles)
+        out.write(puzzle.second);
+    out.flush();
+    if (not out.ok()) {
+        cerr << "Could not write " << files[0] << "." << endl;
+        return 1;
+    }
+    cout << puzzles.size() << " puzzles merged." << endl;
+    return 0;
+}
+
+struct Options {
+    int size {7};
+    Format format {Format::TEXT};
+    Campaign campaign;
+    std::string checkpoint;
+    std::string catalog;        // the hole catalog, empty for the default,
+                                // or "none" to make holes as they are needed
+    std::string verdicts;       // the verdict file, empty for the default,
+                                // or "none" to keep verdicts in memory only
+    std::string outfile;
+    int threads {1};
+};
+
+template <int N>
+int run(const Options& options) {
+    const Campaign& campaign = options.campaign;
+    PuzzleWriter<N> out(options.outfile, options.format);
+    if (not out.ok()) {
+        cerr << "Could not open " << options.outfile << " for output."  << endl;
+        exit(1);
+    }
+    Checkpoint checkpoint(options.checkpoint, campaign, N);
+    if (not checkpoint.load<SwissGenerator<N>>()) {
+        cerr << options.checkpoint << " is not a checkpoint of this campaign"
+             << " and shard, or is damaged." << endl;
+        exit(1);
+    }
+    cout << "{\"size\":" << N << ",\"seed\":" << campaign.seed
+         << ",\"trials\":" << campaign.trials
+         << ",\"streams\":" << campaign.streams << ",\"shard\":"
+         << campaign.shard << ",\"shards\":" << campaign.shards << "}" << endl;
+    std::string catalog = options.catalog;
+    if (catalog.empty())
+        catalog = Solver<N>::defaultCatalog();
+    else if (catalog == "none")
+        catalog = "";
+    Solver<N> solver(catalog);
+    std::string file = options.verdicts;
+    if (file.empty())
+        file = VerdictCache<N>::defaultPath();
+    else if (file == "none")
+        file = "";
+    VerdictCache<N> verdicts(file);
+    Tally<N> tally;
+    vector<std::thread> workers;
+    for (int w = 1; w < options.threads; ++w)
+        workers.emplace_back(runStreams<N>, std::cref(solver),
+                             std::cref(campaign), std::ref(tally),
+                             std::ref(checkpoint), std::ref(verdicts),
+                             std::ref(out));
+    runStreams<N>(solver, campaign, tally, checkpoint, verdicts, out);
+    for (auto & worker : workers)
+        worker.join();
+    out.flush();
+    if (not out.ok())
+        cerr << "Could not write " << options.outfile << "." << endl;
+    if (not checkpoint.save())
+        cerr << "Could not write the checkpoint." << endl;
+    tally.telemetry.snapshot(cout);
+    int trials = 0;
+    for (int stream : campaign.mine())
+        trials += campaign.trialsIn(stream);
+    cout << tally.success << " successes in " << trials << " trials." << endl;
+    cout << tally.errors << " errors encountered." << endl;
+    cout << tally.repeats << " repeated puzzles skipped." << endl;
     return 0;
 }
+
+void usage(const char* name) {
+    cerr << "Usage " << name << " trials outfile [threads] [--size 5|7|9|11]\n"
+         << "        [--chain] [--seed n] [--streams n] [--shard k/n]\n"
+         << "        [--checkpoint file] [--format text|jsonl|binary]\n"
+         << "        [--catalog file|none] [--verdicts file|none]\n"
+         << "    or " << name << " [--size n] [--format f] --merge outfile infile..."
+         << endl;
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    // Each size is its own instantiation of the solver and generator,
+    // so N is a constant throughout the search
+    vector<std::string> args(argv+1, argv+argc);
+    Options options;
+    Campaign& campaign = options.campaign;
+    campaign.seed = randomSeed();
+    vector<std::string> positional;
+    bool merging = false;
+    try {
+        for (size_t k = 0; k < args.size(); ++k) {
+            auto & arg = args[k];
+            bool value = k+1 < args.size();
+            if (arg == "--merge")
+                merging = true;
+            else if (arg == "--size" and value)
+                options.size = stoi(args[++k]);
+            else if (arg == "--format" and value) {
+                if (not parseFormat(args[++k], options.format))
+                    usage(argv[0]);
+            }
+            else if (arg == "--chain")
+                campaign.chain = true;
+            else if (arg == "--seed" and value)
+                campaign.seed = std::stoull(args[++k]);
+            else if (arg == "--streams" and value)
+                campaign.streams = stoi(args[++k]);
+            else if (arg == "--shard" and value) {
+                auto & shard = args[++k];
+                auto slash = shard.find('/');
+                if (slash == std::string::npos)
+                    usage(argv[0]);
+                campaign.shard = stoi(shard.substr(0, slash));
+                campaign.shards = stoi(shard.substr(slash+1));
+            }
+            else if (arg == "--checkpoint" and value)
+                options.checkpoint = args[++k];
+            else if (arg == "--catalog" and value)
+                options.catalog = args[++k];
+            else if (arg == "--verdicts" and value)
+                options.verdicts = args[++k];
+            else if (arg.compare(0, 2, "--") == 0)
+                usage(argv[0]);
+            else
+                positional.push_back(arg);
+        }
+        if (merging) {
+            if (positional.size() < 2)
+                usage(argv[0]);
+        }
+        else {
+            if (positional.size() != 2 and positional.size() != 3)
+                usage(argv[0]);
+            campaign.trials = stoi(positional[0]);
+            options.outfile = positional[1];
+            if (positional.size() == 3)
+                options.threads = stoi(positional[2]);
+        }
+    }
+    catch (std::logic_error&) {         // from stoi and stoull
+        usage(argv[0]);
+    }
+    if (campaign.streams < 1 or campaign.shards < 1 or campaign.shard < 0
+        or campaign.shard >= campaign.shards or options.threads < 1)
+        usage(argv[0]);
+    switch (options.size) {
+        case 5:
+            return merging ? merge<5>(positional, options.format) : run<5>(options);
+        case 7:
+            return merging ? merge<7>(positional, options.format) : run<7>(options);
+        case 9:
+            return merging ? merge<9>(positional, options.format) : run<9>(options);
+        case 11:
+            return merging ? merge<11>(positional, options.format) : run<11>(options);
+        default:
+            cerr << "Sizes are 5, 7, 9 and 11." << endl;
+            return 1;
+    }
+}
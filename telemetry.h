@@ -0,0 +1,82 @@
+//
+//  telemetry.h
+//
+//  Progress reports for long runs.  Telemetry counts the trials and the
+//  successes, keeps a histogram of how long each solve took, and adds up
+//  the workers' SearchStats.  Each snapshot is one line of JSON:
+//
+//      elapsed_s, trials, trials_per_s, successes, success_rate
+//      solve_us    bucket k counts the solves that took less than 2^k
+//                  microseconds and at least 2^(k-1); the last bucket
+//                  counts all the longer ones too
+//      search      the search counters, with -DSWISS_STATS=1 only
+//
+//  The caller takes a snapshot when due() says the interval has passed,
+//  so a run writes nothing between snapshots.
+//
+
+#ifndef telemetry_h
+#define telemetry_h
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include "stats.h"
+
+template <int N>
+class Telemetry {
+public:
+    using Clock = std::chrono::steady_clock;
+    static const int BUCKETS = 24;
+private:
+    Clock::time_point started;
+    Clock::time_point last;            // time of the last snapshot
+    double interval;                   // seconds between snapshots
+    long trials {0};
+    long successes {0};
+    std::array<long, BUCKETS> solves {};
+    SearchStats<N> search;
+public:
+    explicit Telemetry(double interval = 10)
+        : started(Clock::now()), last(started), interval(interval) {}
+    void trial() {trials += 1;}
+    void success() {successes += 1;}
+    void solve(double seconds, SearchStats<N>& stats);
+    bool due() const;
+    void snapshot(std::ostream& out);
+};
+
+template <int N>
+void Telemetry<N>::solve(double seconds, SearchStats<N>& stats) {
+    // Count a solve that took seconds, and take over its worker's
+    // counters, which are cleared
+    long micros = seconds * 1e6;
+    int k = 0;
+    while (k < BUCKETS-1 and micros >= 1l << k)
+        k += 1;
+    solves[k] += 1;
+    search += stats;
+    stats = SearchStats<N>();
+}
+
+template <int N>
+bool Telemetry<N>::due() const {
+    return Clock::now() - last >= std::chrono::duration<double>(interval);
+}
+
+template <int N>
+void Telemetry<N>::snapshot(std::ostream& out) {
+    last = Clock::now();
+    double elapsed = std::chrono::duration<double>(last - started).count();
+    out << "{\"elapsed_s\":" << elapsed << ",\"trials\":" << trials
+        << ",\"trials_per_s\":" << (elapsed > 0 ? trials/elapsed : 0)
+        << ",\"successes\":" << successes << ",\"success_rate\":"
+        << (trials > 0 ? double(successes)/trials : 0) << ",\"solve_us\":[";
+    for (int k = 0; k < BUCKETS; ++k)
+        out << (k ? "," : "") << solves[k];
+    out << "]";
+    search.json(out);
+    out << "}" << std::endl;
+}
+
+#endif /* telemetry_h */
@@ -0,0 +1,208 @@
+//
+//  verdicts.h
+//
+//  Remembering which puzzles have been solved.  Rotating or reflecting
+//  a Swiss square gives another Swiss square, with its clues moved the
+//  same way, so the eight images of a clue grid all have the same
+//  number of solutions.  canonical() picks one of them to stand for the
+//  rest, and a VerdictCache keeps whether each canonical grid has a
+//  unique solution, so that a puzzle is never searched twice, nor
+//  written out twice.
+//
+//  Unique puzzles are few and each is written out, so they are kept
+//  for good: in a file of fixed size records appended to as they are
+//  found, and read back, a block at a time, when the next run starts.
+//  Each record goes out in a single write to a file opened for
+//  appending, so several runs on one machine can share the file; a
+//  record cut short by a crash is ignored.  The others are most of the
+//  trials, and are only kept in memory, the most recent ones up to a
+//  limit, which is enough to catch the repeats along a chain.
+//
+//  File layout (native byte order):
+//      FileHeader
+//      { Givens<N> clues; int unique; } for each verdict, where records
+//                      with unique 0, from older runs, are skipped
+//
+
+#ifndef verdicts_h
+#define verdicts_h
+
+#include <string>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <cstring>      // for memmove
+#include <fcntl.h>
+#include <unistd.h>
+#include "alias.h"
+#include "fileheader.h"
+#include "hashing.h"
+
+template <int N>
+Givens<N> canonical(const Givens<N>& clues) {
+    // The least of the images of clues under the eight symmetries of
+    // the square: a transpose or not, then zero to three quarter turns
+    const int DIM = (N-1)/2;
+    Givens<N> best = clues;
+    for (int t = 1; t < 8; ++t) {
+        Givens<N> image;
+        for (int r = 0; r < DIM; ++r)
+        for (int c = 0; c < DIM; ++c) {
+            int i = t & 4 ? c : r;
+            int j = t & 4 ? r : c;
+            for (int k = 0; k < (t & 3); ++k) {
+                int turned = j;
+                j = DIM-1-i;
+                i = turned;
+            }
+            image[i][j] = clues[r][c];
+        }
+        if (image < best)
+            best = image;
+    }
+    return best;
+}
+
+const unsigned VERDICTS_VERSION = 1;
+
+template <int N>
+struct VerdictCache {
+    // Verdicts on canonical clue grids, safe to share between threads
+    enum Verdict {UNKNOWN = -1, NOT_UNIQUE = 0, UNIQUE = 1};
+
+    // path names the cache file, which is made if it is missing.  An
+    // empty name, or a file written for another N, means the verdicts
+    // are only kept in memory.  About the last limit puzzles found not
+    // to be unique are remembered.
+    explicit VerdictCache(const std::string& path = defaultPath(),
+                          size_t limit = 1 << 20);
+    ~VerdictCache();
+    VerdictCache(const VerdictCache&) = delete;
+    VerdictCache& operator=(const VerdictCache&) = delete;
+    static std::string defaultPath();
+    Verdict find(const Givens<N>& key);
+    bool record(const Givens<N>& key, bool unique);
+    size_t size();
+private:
+    struct Record {
+        Givens<N> clues;
+        int unique;
+    };
+    using Set = std::unordered_set<Givens<N>, ArrayHash>;
+    std::mutex lock;
+    Set uniques;
+    Set recent, older;      // not unique; when recent has limit/2 of them
+                            // it becomes older, and older is dropped
+    size_t limit;
+    int fd {-1};            // the file, open for appending, or -1
+
+    bool load(const std::string& path);
+};
+
+template <int N>
+std::string VerdictCache<N>::defaultPath() {
+    return "swiss" + std::to_string(N) + ".verdicts";
+}
+
+template <int N>
+VerdictCache<N>::VerdictCache(const std::string& path, size_t limit) :
+    limit(limit) {
+    if (path.empty())
+        return;
+    // Make the file with its header under a private name and link it
+    // into place, so that a run never sees a file without a header.
+    // If the link fails, someone else has made it already.
+    FileHeader header("SWISSVC", VERDICTS_VERSION, N, sizeof(Record));
+    std::string temp = path + ".tmp." + std::to_string(getpid());
+    int out = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out >= 0) {
+        bool written = write(out, &header, sizeof header) == sizeof header;
+        close(out);
+        if (written)
+            link(temp.c_str(), path.c_str());
+        unlink(temp.c_str());
+    }
+    if (load(path))
+        fd = open(path.c_str(), O_WRONLY | O_APPEND);
+}
+
+template <int N>
+VerdictCache<N>::~VerdictCache() {
+    if (fd >= 0)
+        close(fd);
+}
+
+template <int N>
+bool VerdictCache<N>::load(const std::string& path) {
+    // Read the unique verdicts in path.  Returns false if it cannot be
+    // read or was written for another N or record layout.
+    int in = open(path.c_str(), O_RDONLY);
+    if (in < 0) return false;
+    FileHeader header;
+    FileHeader expected("SWISSVC", VERDICTS_VERSION, N, sizeof(Record));
+    if (read(in, &header, sizeof header) != sizeof header
+        or not (header == expected)) {
+        close(in);
+        return false;
+    }
+    std::vector<Record> block(4096);
+    char* bytes = reinterpret_cast<char*>(block.data());
+    size_t room = block.size()*sizeof(Record);
+    size_t have = 0;        // bytes of block read
+    ssize_t got;
+    while ((got = read(in, bytes + have, room - have)) > 0) {
+        have += got;
+        size_t records = have / sizeof(Record);
+        for (size_t i = 0; i < records; ++i)
+            if (block[i].unique)
+                uniques.insert(block[i].clues);
+        have -= records*sizeof(Record);
+        std::memmove(bytes, bytes + records*sizeof(Record), have);
+    }
+    close(in);
+    return true;
+}
+
+template <int N>
+typename VerdictCache<N>::Verdict VerdictCache<N>::find(const Givens<N>& key) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (uniques.count(key))
+        return UNIQUE;
+    if (recent.count(key) or older.count(key))
+        return NOT_UNIQUE;
+    return UNKNOWN;
+}
+
+template <int N>
+bool VerdictCache<N>::record(const Givens<N>& key, bool unique) {
+    // Keep the verdict on key.  Returns false if there already was one,
+    // as when another thread has just solved the same puzzle.
+    std::lock_guard<std::mutex> guard(lock);
+    if (uniques.count(key) or recent.count(key) or older.count(key))
+        return false;
+    if (not unique) {
+        if (recent.size() >= limit/2) {
+            older.swap(recent);
+            recent.clear();
+        }
+        recent.insert(key);
+        return true;
+    }
+    uniques.insert(key);
+    if (fd >= 0) {
+        Record record {key, 1};
+        if (write(fd, &record, sizeof record) != sizeof record) {
+            close(fd);      // keep going in memory
+            fd = -1;
+        }
+    }
+    return true;
+}
+
+template <int N>
+size_t VerdictCache<N>::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return uniques.size() + recent.size() + older.size();
+}
+
+#endif /* verdicts_h */
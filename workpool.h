@@ -0,0 +1,60 @@
+//
+//  workpool.h
+//
+//  A small pool of worker threads that draw tasks from a shared source
+//  one at a time.  A task is only made when a worker is free to take
+//  it, so a run that stops early never pays for the tasks it did not
+//  reach, and a worker that drew a large task takes no more while the
+//  others go on drawing.
+//
+
+#ifndef workpool_h
+#define workpool_h
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+template <typename Task>
+class WorkPool {
+    std::mutex lock;            // held while a task is made
+    int count;
+    bool stopping {false};      // no more tasks are to be made
+public:
+    explicit WorkPool(int workers) : count(workers) {}
+    int workers() const {return count;}
+    template <typename Source, typename Work>
+    void run(Source next, Work work);
+};
+
+template <typename Task>
+template <typename Source, typename Work>
+void WorkPool<Task>::run(Source next, Work work) {
+    // Calls work(worker, task) on each task that next(task) makes, one
+    // thread per worker, until next returns false.  next is called by
+    // one thread at a time.  work returns false to stop the pool: the
+    // tasks under way are finished, and no more are made.
+    std::vector<std::thread> threads;
+    for (int w = 0; w < workers(); ++w)
+        threads.emplace_back([this, w, &next, &work] {
+            Task task;
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (stopping or not next(task)) {
+                        stopping = true;
+                        return;
+                    }
+                }
+                if (not work(w, task)) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    stopping = true;
+                    return;
+                }
+            }
+        });
+    for (auto & t : threads)
+        t.join();
+}
+
+#endif /* workpool_h */